@@ -0,0 +1,436 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <vector>
+#include "hex.h"
+#include "hexmap.h"
+#include "terrain.h"
+#include "entities.h"
+#include "pathfinding.h"
+#include "visibility.h"
+#include "combat.h"
+#include "rng.h"
+#include "threadpool.h"
+
+// Enemy turn planning.
+// Every unit of the team gets its moves scored on its own pool task, against a snapshot of the board:
+// for each tile it can reach this turn (occupied tiles block, like for the player)
+//   + the best expected damage it can do from there (tileAttackChance x mean damage, more if it likely kills)
+//   + cover against the closest opponent
+//   - threat: what the opponents can be expected to do to it there (exactly for the ones already in
+//     range, at half weight for the ones that would have to move first)
+//   - distance to the closest opponent, so units with nothing to shoot close in
+// The best few options per unit are kept. Units whose class is in AiSettings::mctsClasses (bosses) then
+// run a Monte Carlo search over their best options with whatever is left of the turn's time budget:
+// each playout applies the option and plays a couple of rounds out with greedy units on both sides,
+// options are picked with UCB1 and the one visited most wins. The search only branches at the root,
+// the playouts below it are greedy rather than a deeper tree, which is plenty for a single boss move.
+//
+// Orders are carried out one unit at a time in slot order, falling back to a unit's next option when an
+// earlier unit took its tile or blocked its way, so the parallel planning never has to coordinate.
+// Utility planning is deterministic; with a time budget, what gets planned and how many playouts the boss
+// search fits in depend on the clock. Recordings and replays need the same turn every time, so
+// AiSettings::playoutsPerOption switches to a fixed amount of work instead: no deadline, and the search
+// runs that many playouts per option over AI_FIXED_LANES lanes with their own dice, whatever the pool's size.
+
+const int AI_OPTIONS = 4; // options kept per unit
+const int AI_FIXED_LANES = 4; // independent searches a fixed work search is split into
+
+struct AiSettings {
+    double turnBudgetMs = 30.0;  // planning time for the whole team, units still unplanned past it just hold
+    int playoutsPerOption = 0;   // > 0: fixed work instead of turnBudgetMs, every unit is planned and the boss
+                                 // search runs this many playouts per option
+    uint32_t mctsClasses = 0;    // bit (1 << UnitClass) per class that searches instead of taking the top score
+    int mctsCandidates = 8;      // top scored options the search picks between
+    int playoutRounds = 2;       // rounds played out after the option
+    uint64_t seed = 0;           // playout dice
+
+    float killBonus = 4.0f;
+    float coverWeight = 1.0f;
+    float threatWeight = 0.25f;
+    float approachWeight = 0.5f;
+};
+
+struct AiOption {
+    int tile = -1;                // where to move, the unit's own tile to stay
+    EntityHandle target;          // who to shoot from there, stale if nobody
+    float score = -1e30f;
+};
+
+struct AiOrder {
+    EntityHandle unit;
+    AiOption options[AI_OPTIONS]; // best first
+    int optionCount = 0;
+    bool searched = false;        // picked by the boss search
+};
+
+class AiPlanner {
+public:
+    explicit AiPlanner(const AiSettings& settings = AiSettings()) : settings(settings) {}
+
+    // Plans the turn for every unit of team, reset their move points first. Reads the board only,
+    // use execute() to carry it out.
+    void plan(const HexMap& map, const EntityStore& units, Team team, const TileRegistry& terrain,
+              const TileRegistry& decorations, ThreadPool& pool, std::vector<AiOrder>& orders) {
+        auto start = std::chrono::steady_clock::now();
+        lastPlayouts = 0;
+        plans++; // playouts roll different dice every turn, and the same ones again in a replay
+        deadline = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                               std::chrono::duration<double, std::milli>(settings.turnBudgetMs));
+        Board board{map, units, team, TerrainCost(map, terrain, decorations), TerrainSight(map, terrain, decorations), {}};
+        for (int i = 0; i < units.count(); i++) {
+            if (units.team[i] != team) board.opponents.push_back(i);
+        }
+
+        std::vector<int> mine;
+        for (int i = 0; i < units.count(); i++) {
+            if (units.team[i] == team) mine.push_back(i);
+        }
+        orders.assign(mine.size(), AiOrder());
+        std::vector<std::vector<AiOption>> bossOptions(mine.size());
+        pool.parallelFor(static_cast<int>(mine.size()), [&](int k) {
+            int slot = mine[k];
+            AiOrder& order = orders[k];
+            order.unit = units.handle(slot);
+            bool boss = (settings.mctsClasses >> units.unitClass[slot]) & 1;
+            if (settings.playoutsPerOption <= 0 && std::chrono::steady_clock::now() >= deadline && !boss) {
+                order.options[0] = holdOption(board, slot);
+                order.optionCount = 1;
+                return;
+            }
+            // bosses keep all their options for the search
+            Scratch& s = scratch();
+            std::vector<AiOption>& options = boss ? bossOptions[k] : s.options;
+            scoreOptions(board, slot, s, options);
+            order.optionCount = std::min(AI_OPTIONS, static_cast<int>(options.size()));
+            std::partial_sort(options.begin(), options.begin() + order.optionCount, options.end(), betterOption);
+            for (int o = 0; o < order.optionCount; o++) order.options[o] = options[o];
+        });
+
+        // what's left of the budget goes to the bosses, each one's playouts split over the pool
+        for (size_t k = 0; k < mine.size(); k++) {
+            if (!bossOptions[k].empty()) search(board, mine[k], bossOptions[k], pool, orders[k], static_cast<uint64_t>(k));
+        }
+        lastPlanMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Carries the orders out: each unit walks to its best option that's still free and reachable, then
+    // shoots its target (or whoever is easiest to hit from there, if the target is gone). Deaths are
+    // processed at the end. Returns the number of attacks made.
+    int execute(const HexMap& map, EntityStore& units, const std::vector<AiOrder>& orders, const TileRegistry& terrain,
+                const TileRegistry& decorations, Pcg32& rng) {
+        TerrainCost terrainCost(map, terrain, decorations);
+        TerrainSight sight(map, terrain, decorations);
+        int attacks = 0;
+        for (const AiOrder& order : orders) {
+            int slot = units.slot(order.unit);
+            if (slot == NO_ENTITY || units.health[slot] <= 0) continue;
+            int from = units.tile[slot];
+            auto cost = [&](int i) { return units.occupant(i) != NO_ENTITY ? PATH_BLOCKED : terrainCost(i); };
+            EntityHandle target;
+            for (int o = 0; o < order.optionCount; o++) {
+                const AiOption& option = order.options[o];
+                if (option.tile != from &&
+                    !executePathfinder.findPath(map, from, option.tile, cost, executePath, units.movePoints[slot])) continue;
+                if (option.tile != from) units.move(slot, option.tile);
+                target = option.target;
+                break;
+            }
+            units.movePoints[slot] = 0;
+            int t = units.slot(target);
+            if (t == NO_ENTITY || units.health[t] <= 0 || attackChance(map, units, slot, t, sight) == 0) t = easiestTarget(map, units, slot, sight);
+            if (t == NO_ENTITY) continue;
+            attack(map, units, slot, t, sight, rng);
+            attacks++;
+        }
+        units.processDeaths(map);
+        return attacks;
+    }
+
+    double lastPlanMilliseconds() const { return lastPlanMs; }
+    // boss playouts in the last plan(), all bosses together
+    int lastPlayoutCount() const { return lastPlayouts; }
+
+private:
+    struct Board {
+        const HexMap& map;
+        const EntityStore& units;
+        Team team;
+        TerrainCost terrainCost;
+        TerrainSight sight;
+        std::vector<int> opponents; // slots
+    };
+
+    // search buffers, one set per thread so the planner can run on any pool
+    struct Scratch {
+        HexPathfinder pathfinder;
+        std::vector<int> reachable;
+        std::vector<AiOption> options;
+        std::vector<int> targets;
+    };
+    static Scratch& scratch() {
+        static thread_local Scratch s;
+        return s;
+    }
+
+    static bool betterOption(const AiOption& a, const AiOption& b) { return a.score > b.score; }
+
+    template <typename Sight>
+    static int easiestTarget(const HexMap& map, const EntityStore& units, int slot, const Sight& sight) {
+        int best = NO_ENTITY;
+        int bestChance = 0;
+        for (int j = 0; j < units.count(); j++) {
+            if (units.team[j] == units.team[slot] || units.health[j] <= 0) continue;
+            int c = attackChance(map, units, slot, j, sight);
+            if (c > bestChance) {
+                bestChance = c;
+                best = j;
+            }
+        }
+        return best;
+    }
+
+    // stay and shoot whatever is easiest, for units the budget didn't reach
+    AiOption holdOption(const Board& board, int slot) const {
+        AiOption option;
+        option.tile = board.units.tile[slot];
+        int t = easiestTarget(board.map, board.units, slot, board.sight);
+        if (t != NO_ENTITY) option.target = board.units.handle(t);
+        option.score = 0.0f;
+        return option;
+    }
+
+    AiOption scoreTile(const Board& board, int slot, int tile) const {
+        const EntityStore& units = board.units;
+        UnitClass cls = units.unitClass[slot];
+        Hex at = board.map.hexAt(tile);
+        AiOption option;
+        option.tile = tile;
+        float offense = 0.0f;
+        float threat = 0.0f;
+        int nearest = INT_MAX;
+        int nearestTile = -1;
+        for (int o : board.opponents) {
+            int theirTile = units.tile[o];
+            UnitClass theirClass = units.unitClass[o];
+            int distance = hex_distance(at, board.map.hexAt(theirTile));
+            if (distance < nearest) {
+                nearest = distance;
+                nearestTile = theirTile;
+            }
+            int chance = tileAttackChance(board.map, cls, tile, theirTile, board.sight);
+            if (chance > 0) {
+                float value = chance * 0.01f * meanDamage(cls);
+                if (meanDamage(cls) >= units.health[o]) value += chance * 0.01f * settings.killBonus;
+                if (value > offense) {
+                    offense = value;
+                    option.target = units.handle(o);
+                }
+            }
+            const WeaponStats& theirs = CLASS_WEAPONS[theirClass];
+            if (distance <= theirs.range) {
+                threat += tileAttackChance(board.map, theirClass, theirTile, tile, board.sight) * 0.01f * meanDamage(theirClass);
+            } else if (distance <= theirs.range + CLASS_STATS[theirClass].movePoints) {
+                threat += 0.5f * hitChance(theirClass, theirs.range, coverAgainst(board.map, theirTile, tile, board.sight)) * 0.01f *
+                          meanDamage(theirClass);
+            }
+        }
+        float cover = nearestTile >= 0 ? static_cast<float>(coverAgainst(board.map, nearestTile, tile, board.sight)) : 0.0f;
+        option.score = offense + settings.coverWeight * cover - settings.threatWeight * threat -
+                       settings.approachWeight * (nearest == INT_MAX ? 0 : nearest);
+        return option;
+    }
+
+    void scoreOptions(const Board& board, int slot, Scratch& s, std::vector<AiOption>& options) const {
+        const EntityStore& units = board.units;
+        auto cost = [&](int i) { return units.occupant(i) != NO_ENTITY ? PATH_BLOCKED : board.terrainCost(i); };
+        s.pathfinder.movementRange(board.map, units.tile[slot], units.movePoints[slot], cost, s.reachable);
+        options.clear();
+        options.push_back(scoreTile(board, slot, units.tile[slot]));
+        for (int tile : s.reachable) options.push_back(scoreTile(board, slot, tile));
+    }
+
+    // ---- boss search ----
+
+    struct OptionStats {
+        double reward = 0.0;
+        int visits = 0;
+    };
+
+    void search(const Board& board, int slot, std::vector<AiOption>& options, ThreadPool& pool, AiOrder& order, uint64_t stream) {
+        int n = std::min(settings.mctsCandidates, static_cast<int>(options.size()));
+        std::partial_sort(options.begin(), options.begin() + n, options.end(), betterOption);
+        options.resize(n);
+        if (n <= 1) return;
+
+        // root parallel: every worker searches on its own and the visit counts are added up at the end.
+        // With fixed work there's a fixed number of lanes instead, so the result doesn't depend on the pool
+        bool fixed = settings.playoutsPerOption > 0;
+        int workers = fixed ? AI_FIXED_LANES : std::max(1, pool.threadCount());
+        int lanePlayouts = fixed ? std::max(n, (n * settings.playoutsPerOption + AI_FIXED_LANES - 1) / AI_FIXED_LANES) : 0;
+        std::vector<std::vector<OptionStats>> perWorker(workers, std::vector<OptionStats>(n));
+        TaskGroup group(pool);
+        for (int w = 0; w < workers; w++) {
+            group.submit([&, w] {
+                Pcg32 rng(settings.seed, (plans << 40) | (stream << 10) | static_cast<uint64_t>(w));
+                std::vector<OptionStats>& stats = perWorker[w];
+                // the playout board is units only (the store has no per-tile tables, entities.h), and
+                // assigning over it every playout reuses its storage
+                EntityStore sim;
+                int total = 0;
+                // at least one playout per option, even when the budget is already gone
+                while (total < n || (fixed ? total < lanePlayouts : std::chrono::steady_clock::now() < deadline)) {
+                    int pick = total < n ? total : ucbPick(stats, total);
+                    sim = board.units;
+                    stats[pick].reward += playout(board, sim, slot, options[pick], rng);
+                    stats[pick].visits++;
+                    total++;
+                }
+            });
+        }
+        group.wait();
+
+        std::vector<OptionStats> merged(n);
+        for (const std::vector<OptionStats>& stats : perWorker) {
+            for (int o = 0; o < n; o++) {
+                merged[o].reward += stats[o].reward;
+                merged[o].visits += stats[o].visits;
+                lastPlayouts += stats[o].visits;
+            }
+        }
+        std::vector<int> byVisits(n);
+        for (int o = 0; o < n; o++) byVisits[o] = o;
+        std::stable_sort(byVisits.begin(), byVisits.end(), [&](int a, int b) { return merged[a].visits > merged[b].visits; });
+        order.optionCount = std::min(AI_OPTIONS, n);
+        for (int o = 0; o < order.optionCount; o++) order.options[o] = options[byVisits[o]];
+        order.searched = true;
+    }
+
+    static int ucbPick(const std::vector<OptionStats>& stats, int total) {
+        int best = 0;
+        double bestValue = -1.0;
+        double logTotal = std::log(static_cast<double>(total));
+        for (size_t o = 0; o < stats.size(); o++) {
+            double value = stats[o].reward / stats[o].visits + 1.4 * std::sqrt(logTotal / stats[o].visits);
+            if (value > bestValue) {
+                bestValue = value;
+                best = static_cast<int>(o);
+            }
+        }
+        return best;
+    }
+
+    static int teamHealth(const EntityStore& units, Team team) {
+        int total = 0;
+        for (int i = 0; i < units.count(); i++) {
+            if (units.team[i] == team) total += std::max(0, units.health[i]);
+        }
+        return total;
+    }
+
+    // One playout on a copy of the board, 0..1 (0.5 = even trade, higher is better for the boss's team).
+    double playout(const Board& board, EntityStore& sim, int slot, const AiOption& option, Pcg32& rng) const {
+        Team us = board.team;
+        Team them = us == TEAM_PLAYER ? TEAM_ENEMY : TEAM_PLAYER;
+        int ourBefore = teamHealth(sim, us);
+        int theirBefore = teamHealth(sim, them);
+
+        if (option.tile != sim.tile[slot]) sim.move(slot, option.tile);
+        int target = sim.slot(option.target);
+        if (target != NO_ENTITY) attack(board.map, sim, slot, target, board.sight, rng);
+        sim.processDeaths(board.map);
+
+        // the rest of our team has already been planned, playouts start with the other side's reply
+        for (int round = 0; round < settings.playoutRounds; round++) {
+            greedyTurn(board, sim, them, rng);
+            greedyTurn(board, sim, us, rng);
+        }
+        double swing = (theirBefore - teamHealth(sim, them)) - (ourBefore - teamHealth(sim, us));
+        return 0.5 + 0.5 * std::tanh(swing / 20.0);
+    }
+
+    // Every unit shoots the easiest target, or steps toward the closest opponent if it has none.
+    void greedyTurn(const Board& board, EntityStore& sim, Team side, Pcg32& rng) const {
+        // the other side's slots, once per turn (nobody is removed until processDeaths)
+        std::vector<int>& targets = scratch().targets;
+        targets.clear();
+        for (int i = 0; i < sim.count(); i++) {
+            if (sim.team[i] != side) targets.push_back(i);
+        }
+        for (int i = 0; i < sim.count(); i++) {
+            if (sim.team[i] != side || sim.health[i] <= 0) continue;
+            int t = easiestOf(board, sim, i, targets);
+            if (t == NO_ENTITY) {
+                step(board, sim, i, targets);
+                t = easiestOf(board, sim, i, targets);
+            }
+            if (t != NO_ENTITY) attack(board.map, sim, i, t, board.sight, rng);
+        }
+        sim.processDeaths(board.map);
+    }
+
+    static int easiestOf(const Board& board, const EntityStore& sim, int slot, const std::vector<int>& targets) {
+        int best = NO_ENTITY;
+        int bestChance = 0;
+        int range = CLASS_WEAPONS[sim.unitClass[slot]].range;
+        Hex at = board.map.hexAt(sim.tile[slot]);
+        for (int j : targets) {
+            if (sim.health[j] <= 0 || hex_distance(at, board.map.hexAt(sim.tile[j])) > range) continue;
+            int c = attackChance(board.map, sim, slot, j, board.sight);
+            if (c > bestChance) {
+                bestChance = c;
+                best = j;
+            }
+        }
+        return best;
+    }
+
+    // up to movePoints single steps, each to the free neighbor closest to the nearest target
+    static void step(const Board& board, EntityStore& sim, int slot, const std::vector<int>& targets) {
+        int goal = -1;
+        int goalDistance = INT_MAX;
+        Hex start = board.map.hexAt(sim.tile[slot]);
+        for (int j : targets) {
+            if (sim.health[j] <= 0) continue;
+            int d = hex_distance(start, board.map.hexAt(sim.tile[j]));
+            if (d < goalDistance) {
+                goalDistance = d;
+                goal = sim.tile[j];
+            }
+        }
+        if (goal < 0) return;
+        Hex goalHex = board.map.hexAt(goal);
+        int budget = CLASS_STATS[sim.unitClass[slot]].movePoints;
+        while (budget > 0 && goalDistance > 1) {
+            int here = sim.tile[slot];
+            int best = -1;
+            int bestCost = 0;
+            for (int d = 0; d < 6; d++) {
+                int next = board.map.neighbor(here, d);
+                if (next < 0 || sim.occupant(next) != NO_ENTITY) continue;
+                int cost = board.terrainCost(next);
+                if (cost == PATH_BLOCKED || cost > budget) continue;
+                int distance = hex_distance(board.map.hexAt(next), goalHex);
+                if (distance < goalDistance) {
+                    goalDistance = distance;
+                    best = next;
+                    bestCost = cost;
+                }
+            }
+            if (best < 0) return;
+            sim.move(slot, best);
+            budget -= bestCost;
+        }
+    }
+
+    AiSettings settings;
+    std::chrono::steady_clock::time_point deadline;
+    double lastPlanMs = 0.0;
+    int lastPlayouts = 0;
+    uint64_t plans = 0; // plan() calls so far, part of the playouts' dice stream
+    HexPathfinder executePathfinder;
+    std::vector<int> executePath;
+};
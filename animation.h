@@ -0,0 +1,157 @@
+#pragma once
+
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "sprites.h"
+#include "assets.h"
+#include "entities.h"
+#include "log.h"
+
+// Sprite animations.
+// Clips are defined in a text file (assets/animations.txt) as a frame rate plus a list of frames, the
+// frames being "surface" assets from the manifest. Every frame of every clip goes into one TextureAtlas,
+// so all the units on screen are drawn with one SpriteBatch, whatever they're playing.
+// Playback state is two components in the EntityStore (animClip, animTime) that advance() sweeps once
+// per simulation tick, the renderer only turns (clip, time) into an atlas region.
+//
+// File format, '#' starts a comment:
+//   clip   ancp-stand  6  loop        ancp-male-std-one ancp-male-std-two ...
+//   clip   ancp-run    8  ancp-stand  ancp-male-run-one ancp-male-run-two
+//   class  assault     ancp-stand  ancp-run
+// A clip either loops or plays once and then switches to the clip named in its place.
+// "class" picks the idle and move clips for a unit class, "class default" is used for the rest.
+
+struct AnimationClip {
+    std::string name;
+    float frameSeconds;
+    int firstFrame;   // into the library's frame list
+    int frameCount;
+    int next;         // clip that follows one play-through, -1 if it loops
+};
+
+class AnimationLibrary {
+public:
+    // Reads the clip file and moves the frames out of the asset manager into atlas (build the atlas after).
+    bool load(const char* path, AssetManager& assets, TextureAtlas& atlas) {
+        std::ifstream in(path);
+        if (!in) {
+            LOG_ERROR("Can't open animation file %s", path);
+            return false;
+        }
+        std::vector<std::string> nextNames;
+        std::string line;
+        for (int lineNumber = 1; std::getline(in, line); lineNumber++) {
+            std::istringstream words(line.substr(0, line.find('#')));
+            std::string keyword;
+            if (!(words >> keyword)) continue;
+            if (keyword == "clip") {
+                std::string name, after, frame;
+                float fps = 0;
+                if (!(words >> name >> fps >> after) || fps <= 0) return error(path, lineNumber, "expected 'clip name fps loop|next frames...'");
+                AnimationClip clip = {name, 1.0f / fps, static_cast<int>(frames.size()), 0, -1};
+                while (words >> frame) {
+                    int region = atlas.find(frame);
+                    if (region < 0) {
+                        SDL_Surface* surface = assets.takeSurface(assets.handle(frame));
+                        if (surface == nullptr) return error(path, lineNumber, "frame isn't a loaded surface asset");
+                        region = atlas.add(frame, surface);
+                    }
+                    frames.push_back(region);
+                    clip.frameCount++;
+                }
+                if (clip.frameCount == 0) return error(path, lineNumber, "clip without frames");
+                byName[name] = static_cast<int>(clips.size());
+                clips.push_back(clip);
+                nextNames.push_back(after == "loop" ? "" : after);
+            } else if (keyword == "class") {
+                std::string cls, idle, move;
+                if (!(words >> cls >> idle)) return error(path, lineNumber, "expected 'class name idle [move]'");
+                if (!(words >> move)) move = idle;
+                int c = -1;
+                for (int k = 0; k < CLASS_COUNT; k++) {
+                    if (cls == CLASS_STATS[k].name) c = k;
+                }
+                if (c < 0 && cls != "default") return error(path, lineNumber, "unknown class");
+                int idleClip = clip(idle);
+                int moveClip = clip(move);
+                if (idleClip < 0 || moveClip < 0) return error(path, lineNumber, "class uses a clip that isn't defined above");
+                if (c < 0) {
+                    defaultIdle = idleClip;
+                    defaultMove = moveClip;
+                } else {
+                    idleClips[c] = idleClip;
+                    moveClips[c] = moveClip;
+                }
+            } else {
+                return error(path, lineNumber, "unknown keyword");
+            }
+        }
+        // follow-up clips can be defined further down the file, so they're resolved at the end
+        for (size_t i = 0; i < clips.size(); i++) {
+            if (nextNames[i].empty()) continue;
+            clips[i].next = clip(nextNames[i]);
+            if (clips[i].next < 0) LOG_ERROR("%s: clip %s continues with unknown clip %s", path, clips[i].name.c_str(), nextNames[i].c_str());
+        }
+        return true;
+    }
+
+    // -1 if there's no such clip
+    int clip(const std::string& name) const {
+        auto it = byName.find(name);
+        return it == byName.end() ? -1 : it->second;
+    }
+
+    int idleClip(UnitClass cls) const { return idleClips[cls] >= 0 ? idleClips[cls] : defaultIdle; }
+    int moveClip(UnitClass cls) const { return moveClips[cls] >= 0 ? moveClips[cls] : defaultMove; }
+
+    // atlas region of the frame shown t seconds into a clip, -1 for no clip
+    int frameAt(int clipId, float t) const {
+        if (clipId < 0) return -1;
+        const AnimationClip& c = clips[clipId];
+        int f = static_cast<int>(t / c.frameSeconds);
+        if (f >= c.frameCount) f = c.frameCount - 1;
+        if (f < 0) f = 0;
+        return frames[c.firstFrame + f];
+    }
+
+    // Starts a clip from the beginning, or leaves it alone if it's already playing.
+    void play(EntityStore& units, int slot, int clipId) const {
+        if (units.animClip[slot] == clipId) return;
+        units.animClip[slot] = clipId;
+        units.animTime[slot] = 0.0f;
+    }
+
+    // One simulation tick for every unit. Looping clips wrap around, one-shot clips hand over to their next clip.
+    void advance(EntityStore& units, float dt) const {
+        for (int i = 0; i < units.count(); i++) {
+            int c = units.animClip[i];
+            if (c < 0) continue;
+            const AnimationClip& clip = clips[c];
+            float length = clip.frameSeconds * clip.frameCount;
+            float t = units.animTime[i] + dt;
+            if (t >= length) {
+                t = std::fmod(t, length);
+                if (clip.next >= 0) units.animClip[i] = clip.next;
+            }
+            units.animTime[i] = t;
+        }
+    }
+
+private:
+    static bool error(const char* path, int line, const char* message) {
+        LOG_ERROR("%s:%d: %s", path, line, message);
+        return false;
+    }
+
+    std::vector<AnimationClip> clips;
+    std::vector<int> frames; // atlas region per frame, clips index into this
+    std::unordered_map<std::string, int> byName;
+    int idleClips[CLASS_COUNT] = {-1, -1, -1, -1, -1, -1};
+    int moveClips[CLASS_COUNT] = {-1, -1, -1, -1, -1, -1};
+    int defaultIdle = -1;
+    int defaultMove = -1;
+};
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <SDL.h>
+#include <SDL_image.h>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "threadpool.h"
+#include "log.h"
+#include "profiler.h"
+
+// Asset loading.
+// Images are listed in a manifest and referred to by name, the game looks a name up once and keeps
+// the AssetHandle. Loading is split in two:
+// - decoding (IMG_Load, the slow part) runs on a thread pool, all images at once
+// - turning surfaces into textures has to happen on the render thread, pump() does that a few
+//   milliseconds at a time so a loading screen can keep drawing progress() in between
+//
+// Manifest lines look like
+//   texture  player-idle  assets/ancp-male-std-one.png
+//   surface  tile         assets/tile-test-blue.png
+// "texture" becomes an SDL_Texture, "surface" is kept as a surface for packing into an atlas
+// (take it with takeSurface()). '#' starts a comment.
+// Workers report back into the manager, so keep it alive until done() (or finishAll()).
+
+typedef int AssetHandle;
+const AssetHandle NO_ASSET = -1;
+
+enum AssetKind {
+    ASSET_TEXTURE,
+    ASSET_SURFACE
+};
+
+class AssetManager {
+public:
+    AssetManager() = default;
+    AssetManager(const AssetManager&) = delete;
+    AssetManager& operator=(const AssetManager&) = delete;
+    ~AssetManager() { destroy(); }
+
+    // Reads the manifest and starts decoding everything in it. Returns false if the manifest can't be read
+    // or has broken lines, images that fail to load show up in failures() once they're done.
+    bool load(const char* manifestPath, ThreadPool& pool) {
+        std::ifstream in(manifestPath);
+        if (!in) {
+            LOG_ERROR("Can't open asset manifest %s", manifestPath);
+            return false;
+        }
+        std::string line;
+        for (int lineNumber = 1; std::getline(in, line); lineNumber++) {
+            std::istringstream words(line.substr(0, line.find('#')));
+            std::string kind, name, path;
+            if (!(words >> kind)) continue;
+            if (!(words >> name >> path) || (kind != "texture" && kind != "surface")) {
+                LOG_ERROR("%s:%d: expected 'texture|surface name path'", manifestPath, lineNumber);
+                return false;
+            }
+            add(name, path, kind == "texture" ? ASSET_TEXTURE : ASSET_SURFACE, pool);
+        }
+        return true;
+    }
+
+    // Queues one image outside of a manifest. Adding a name twice just returns the existing handle.
+    AssetHandle add(const std::string& name, const std::string& path, AssetKind kind, ThreadPool& pool) {
+        auto it = byName.find(name);
+        if (it != byName.end()) return it->second;
+        AssetHandle h = static_cast<AssetHandle>(assets.size());
+        assets.push_back(Asset{name, path, kind});
+        byName.emplace(name, h);
+        // the worker only gets the path and hands the surface back through the queue,
+        // so assets can keep growing while images are being decoded
+        pool.submit([this, h, path] {
+            SDL_Surface* surface = IMG_Load(path.c_str());
+            if (surface == nullptr) LOG_ERROR("Failed to load image %s. SDL_Error: %s", path.c_str(), IMG_GetError());
+            std::lock_guard<std::mutex> lock(decodedMutex);
+            decoded.push_back(Decoded{h, surface});
+        });
+        return h;
+    }
+
+    // Render thread only. Uploads decoded images until budgetMs is used up (0 = everything that's ready).
+    // Returns true once every queued asset is finished.
+    bool pump(SDL_Renderer* renderer, double budgetMs = 0) {
+        auto start = std::chrono::steady_clock::now();
+        {
+            std::lock_guard<std::mutex> lock(decodedMutex);
+            ready.insert(ready.end(), decoded.begin(), decoded.end());
+            decoded.clear();
+        }
+        size_t k = 0;
+        for (; k < ready.size(); k++) {
+            if (budgetMs > 0 && k > 0) {
+                double spent = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                if (spent >= budgetMs) break;
+            }
+            finish(renderer, ready[k]);
+        }
+        ready.erase(ready.begin(), ready.begin() + k);
+        return done();
+    }
+
+    // blocks until everything is decoded and uploaded, for tools and tests
+    void finishAll(SDL_Renderer* renderer, ThreadPool& pool) {
+        pool.wait();
+        pump(renderer);
+    }
+
+    bool done() const { return finished == static_cast<int>(assets.size()); }
+    // 0..1
+    double progress() const { return assets.empty() ? 1.0 : static_cast<double>(finished) / assets.size(); }
+    int loaded() const { return finished; }
+    int total() const { return static_cast<int>(assets.size()); }
+    int failures() const { return failed; }
+
+    // NO_ASSET for names that aren't in the manifest
+    AssetHandle handle(const std::string& name) const {
+        auto it = byName.find(name);
+        if (it == byName.end()) {
+            LOG_WARN("No asset named %s", name.c_str());
+            return NO_ASSET;
+        }
+        return it->second;
+    }
+
+    // nullptr until the asset is loaded (or if it failed)
+    SDL_Texture* texture(AssetHandle h) const {
+        return h < 0 ? nullptr : assets[h].texture;
+    }
+
+    int width(AssetHandle h) const { return h < 0 ? 0 : assets[h].w; }
+    int height(AssetHandle h) const { return h < 0 ? 0 : assets[h].h; }
+    const std::string& name(AssetHandle h) const { return assets[h].name; }
+
+    // Hands a loaded "surface" asset over to the caller (a TextureAtlas, usually). nullptr the second time.
+    SDL_Surface* takeSurface(AssetHandle h) {
+        if (h < 0) return nullptr;
+        SDL_Surface* s = assets[h].surface;
+        assets[h].surface = nullptr;
+        return s;
+    }
+
+    // Frees everything loaded so far, uploaded or not. Call before the renderer is destroyed.
+    void destroy() {
+        for (Asset& a : assets) {
+            if (a.texture != nullptr) SDL_DestroyTexture(a.texture);
+            if (a.surface != nullptr) SDL_FreeSurface(a.surface);
+            a.texture = nullptr;
+            a.surface = nullptr;
+        }
+        for (const Decoded& d : ready) {
+            if (d.surface != nullptr) SDL_FreeSurface(d.surface);
+        }
+        ready.clear();
+        // decoded after the last pump(); wait for the pool first if loading may still be going
+        std::lock_guard<std::mutex> lock(decodedMutex);
+        for (const Decoded& d : decoded) {
+            if (d.surface != nullptr) SDL_FreeSurface(d.surface);
+        }
+        decoded.clear();
+    }
+
+private:
+    struct Asset {
+        std::string name;
+        std::string path;
+        AssetKind kind;
+        SDL_Surface* surface = nullptr;
+        SDL_Texture* texture = nullptr;
+        int w = 0;
+        int h = 0;
+    };
+    struct Decoded {
+        AssetHandle handle;
+        SDL_Surface* surface; // nullptr if decoding failed
+    };
+
+    void finish(SDL_Renderer* renderer, const Decoded& d) {
+        Asset& a = assets[d.handle];
+        finished++;
+        if (d.surface == nullptr) {
+            failed++;
+            return;
+        }
+        a.w = d.surface->w;
+        a.h = d.surface->h;
+        if (a.kind == ASSET_SURFACE) {
+            a.surface = d.surface;
+            return;
+        }
+        a.texture = SDL_CreateTextureFromSurface(renderer, d.surface);
+        SDL_FreeSurface(d.surface);
+        if (a.texture == nullptr) {
+            LOG_ERROR("Failed to create texture for %s. SDL_Error: %s", a.path.c_str(), SDL_GetError());
+            failed++;
+            return;
+        }
+        PROFILE_COUNT(PROFILE_TEXTURES_CREATED, 1);
+    }
+
+    std::vector<Asset> assets;
+    std::unordered_map<std::string, AssetHandle> byName;
+    int finished = 0;
+    int failed = 0;
+
+    std::mutex decodedMutex;
+    std::vector<Decoded> decoded;  // filled by the workers
+    std::vector<Decoded> ready;    // taken from decoded, waiting for pump's time budget
+};
@@ -0,0 +1,79 @@
+// Benchmark for the enemy turn planner (ai.h): a peasant tide with a boss against a small player squad
+// on a generated map. Plans and carries out a few enemy turns with plain utility scoring, then again
+// with the boss (the heavy) searching, and prints how long each part of a turn took.
+//
+// g++ -O2 -std=c++17 -pthread bench/ai_bench.cpp -o ai_bench && ./ai_bench [peasants] [threads]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "../ai.h"
+#include "../mapgen.h"
+
+static double msSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void setUp(const HexMap& map, EntityStore& units, int peasants, Pcg32& rng) {
+    units = EntityStore();
+    units.resizeMap(map.size());
+    const UnitClass squad[6] = {CLASS_ARCHER, CLASS_ARCHER, CLASS_HEAVY, CLASS_ASSAULT, CLASS_HACKER, CLASS_MEDIC};
+    for (UnitClass cls : squad) {
+        int tile;
+        do {
+            int row = rng.range(0, map.height() - 1); // its own statement, so the dice roll in the same order everywhere
+            tile = row * map.width() + rng.range(0, 7);
+        } while (units.occupant(tile) != NO_ENTITY);
+        units.spawn(TEAM_PLAYER, cls, tile);
+    }
+    for (int i = 0; i <= peasants; i++) {
+        int tile;
+        do {
+            int row = rng.range(0, map.height() - 1);
+            tile = row * map.width() + rng.range(12, map.width() - 1);
+        } while (units.occupant(tile) != NO_ENTITY);
+        // the first one is the boss
+        units.spawn(TEAM_ENEMY, i == 0 ? CLASS_HEAVY : CLASS_PEASANT, tile);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    int peasants = argc > 1 ? std::atoi(argv[1]) : 1000;
+    int threads = argc > 2 ? std::atoi(argv[2]) : 0;
+
+    TileRegistry terrain;
+    TileRegistry decorations;
+    MapGenSettings mapSettings;
+    mapSettings.seed = 7;
+    MapGenerator generator(registerBiomes(terrain, decorations), mapSettings);
+    HexMap map(64, 64);
+    generator.generate(map);
+    ThreadPool pool(threads);
+    printf("%d peasants + 1 heavy vs 6 on a %dx%d map, %d threads\n", peasants, map.width(), map.height(), pool.threadCount());
+
+    for (int boss = 0; boss < 2; boss++) {
+        AiSettings settings;
+        settings.seed = 1;
+        if (boss) settings.mctsClasses = 1u << CLASS_HEAVY;
+        AiPlanner planner(settings);
+        EntityStore units;
+        Pcg32 rng(42, 0);
+        setUp(map, units, peasants, rng);
+        std::vector<AiOrder> orders;
+        printf("%s\n", boss ? "boss search on" : "utility only");
+        for (int turn = 1; turn <= 5; turn++) {
+            units.resetMovePoints(TEAM_ENEMY);
+            auto start = std::chrono::steady_clock::now();
+            planner.plan(map, units, TEAM_ENEMY, terrain, decorations, pool, orders);
+            double planMs = msSince(start);
+            start = std::chrono::steady_clock::now();
+            int attacks = planner.execute(map, units, orders, terrain, decorations, rng);
+            double executeMs = msSince(start);
+            int players = 0;
+            for (int i = 0; i < units.count(); i++) players += units.team[i] == TEAM_PLAYER;
+            printf("  turn %d: plan %.2f ms (%d playouts), execute %.2f ms, %d attacks, %d player units left\n", turn, planMs,
+                   planner.lastPlayoutCount(), executeMs, attacks, players);
+        }
+    }
+    return 0;
+}
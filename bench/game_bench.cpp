@@ -0,0 +1,244 @@
+// The benchmark suite: hex math, hashing, map traversal and generation, and (when built against the game
+// library, see CMakeLists.txt) whole frames of render() drawn offscreen. Prints a line per benchmark and
+// writes every number to a JSON file so runs can be compared over time:
+//   {"hex_to_pixel":{"iterations":..,"ns_per_op":..}, ..., "render_map":{"count":..,"mean_ms":..,"ms":[..]}, ...}
+// the per-sample series are in the same format as the replay reports (replay.h).
+//
+// cmake --build build --target bench (runs it from the repo root, the game needs assets/ and ttf/)
+// ./build/game_bench [out.json] [map width] [map height], default game_bench.json 1024 1024
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../hex.h"
+#include "../hexmap.h"
+#include "../mapgen.h"
+#include "../replay.h"
+#if BENCH_WITH_GAME
+#include <SDL.h>
+#include "../game.h"
+#endif
+
+static double msSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+struct Result {
+    std::string name;
+    long long iterations;
+    double nsPerOp;
+};
+std::vector<Result> results;
+std::vector<std::unique_ptr<FrameTimings>> series; // the benchmarks timed a run at a time
+volatile double sink; // keeps the compiler from dropping the work
+
+static FrameTimings* addSeries(const char* name) {
+    series.emplace_back(new FrameTimings(name));
+    return series.back().get();
+}
+
+// Times reps passes of body, which does ops operations per pass.
+template <typename Body>
+static void measure(const char* name, int ops, int reps, Body body) {
+    body(); // warm up
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < reps; i++) body();
+    double ns = msSince(start) * 1e6 / (static_cast<double>(ops) * reps);
+    results.push_back(Result{name, static_cast<long long>(ops) * reps, ns});
+    printf("%-24s %10.2f ns/op\n", name, ns);
+}
+
+static void hexMath() {
+    const int N = 1 << 16;
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int> coord(-500, 500);
+    std::uniform_real_distribution<double> pixel(-40000.0, 40000.0);
+    std::vector<Hex> hexes;
+    std::vector<Point> points;
+    std::vector<FracHex> fracs;
+    for (int i = 0; i < N; i++) {
+        hexes.push_back(Hex{coord(rng), coord(rng)}); // braces: left to right, so the same points every run
+        points.push_back(Point{pixel(rng), pixel(rng)});
+    }
+    // the game's layout (main map)
+    const Layout layout(layout_flat, Point(50, 57), Point(0, 0));
+    for (const Point& p : points) fracs.push_back(pixel_to_hex(layout, p));
+
+    measure("hex_to_pixel", N, 200, [&] {
+        double total = 0;
+        for (const Hex& h : hexes) {
+            Point p = hex_to_pixel(layout, h);
+            total += p.x + p.y;
+        }
+        sink = total;
+    });
+    measure("pixel_to_hex", N, 200, [&] {
+        double total = 0;
+        for (const Point& p : points) total += pixel_to_hex(layout, p).q;
+        sink = total;
+    });
+    measure("hex_round", N, 200, [&] {
+        long long total = 0;
+        for (const FracHex& f : fracs) total += hex_round(f).q;
+        sink = static_cast<double>(total);
+    });
+    measure("pixel_to_hex+hex_round", N, 200, [&] {
+        long long total = 0;
+        for (const Point& p : points) total += hex_round(pixel_to_hex(layout, p)).r;
+        sink = static_cast<double>(total);
+    });
+    measure("hex_distance", N - 1, 200, [&] {
+        long long total = 0;
+        for (int i = 0; i + 1 < N; i++) total += hex_distance(hexes[i], hexes[i + 1]);
+        sink = static_cast<double>(total);
+    });
+}
+
+// A 256x256 patch of hexes in a hash map, looked up with random hexes around it (about half are hits).
+template <typename Hash>
+static void hashLookups(const char* name) {
+    std::unordered_map<Hex, int, Hash> table;
+    for (int q = 0; q < 256; q++) {
+        for (int r = 0; r < 256; r++) table.emplace(Hex(q, r), q * 256 + r);
+    }
+    const int N = 1 << 16;
+    std::mt19937 rng(2);
+    std::uniform_int_distribution<int> coord(-64, 319);
+    std::vector<Hex> keys;
+    for (int i = 0; i < N; i++) keys.push_back(Hex{coord(rng), coord(rng)});
+    measure(name, N, 50, [&] {
+        long long total = 0;
+        for (const Hex& h : keys) {
+            auto found = table.find(h);
+            if (found != table.end()) total += found->second;
+        }
+        sink = static_cast<double>(total);
+    });
+}
+
+static void mapTraversal(int width, int height) {
+    TileRegistry terrain;
+    TileRegistry decorations;
+    MapGenSettings settings;
+    settings.seed = 3;
+    MapGenerator generator(registerBiomes(terrain, decorations), settings);
+
+    FrameTimings* generate = addSeries("generate_map");
+    HexMap map(width, height);
+    for (int i = 0; i < 5; i++) {
+        auto start = std::chrono::steady_clock::now();
+        generator.generate(map);
+        generate->add(msSince(start));
+    }
+    printf("%-24s %10.2f ms (%dx%d, one thread)\n", "generate_map", generate->percentile(50), width, height);
+
+    const HexMap& tiles = map;
+    measure("map_sweep", tiles.size(), 10, [&] {
+        long long total = 0;
+        for (int i = 0; i < tiles.size(); i++) total += tiles[i].terrain + tiles[i].decoration;
+        sink = static_cast<double>(total);
+    });
+    measure("map_neighbors", tiles.size() * 6, 5, [&] {
+        long long total = 0;
+        for (int i = 0; i < tiles.size(); i++) {
+            for (int d = 0; d < 6; d++) {
+                int n = tiles.neighbor(i, d);
+                if (n >= 0) total += tiles[n].terrain;
+            }
+        }
+        sink = static_cast<double>(total);
+    });
+}
+
+#if BENCH_WITH_GAME
+// frames of render() into a texture under the dummy video driver, so what's measured is the drawing
+// and not the display
+static bool renderFrames(int width, int height) {
+    GameOptions options;
+    options.seed = 4;
+    options.offscreen = true;
+    options.autosavePath = nullptr; // it runs from the source tree
+    options.vsync = false;
+    options.targetFps = 0;
+    options.generateWidth = width;
+    options.generateHeight = height;
+    if (!startGame(options)) return false;
+
+    int w, h;
+    SDL_GetRendererOutputSize(renderer, &w, &h);
+    SDL_Texture* target = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, w, h);
+    if (target == nullptr) {
+        LOG_ERROR("Can't create a %dx%d render target: %s", w, h, SDL_GetError());
+        stopGame();
+        return false;
+    }
+    SDL_SetRenderTarget(renderer, target);
+    const struct { const char* name; bool map; } screens[] = {{"render_map", true}, {"render_fight", false}};
+    for (const auto& screen : screens) {
+        FrameTimings* frames = addSeries(screen.name);
+        mapMode = screen.map;
+        for (int i = 0; i < 10; i++) render(1.0);
+        for (int i = 0; i < 200; i++) {
+            // pan a little every frame so the tile map's visible range keeps changing
+            camera.x = (i % 50) * 8;
+            auto start = std::chrono::steady_clock::now();
+            render(1.0);
+            frames->add(msSince(start));
+        }
+        printf("%-24s %10.3f ms p50, %.3f p99 (%dx%d)\n", screen.name, frames->percentile(50), frames->percentile(99), w, h);
+    }
+    SDL_SetRenderTarget(renderer, nullptr);
+    SDL_DestroyTexture(target);
+    mapMode = true;
+
+    // initMapSet is the game's map generation, spread over the worker pool
+    FrameTimings* generate = addSeries("initMapSet");
+    for (int i = 0; i < 5; i++) {
+        auto start = std::chrono::steady_clock::now();
+        HexMap map = initMapSet(w, h, 100);
+        generate->add(msSince(start));
+    }
+    printf("%-24s %10.2f ms (%dx%d, worker pool)\n", "initMapSet", generate->percentile(50), generateWidth, generateHeight);
+    return stopGame() == 0;
+}
+#endif
+
+int main(int argc, char* argv[]) {
+    const char* jsonPath = argc > 1 ? argv[1] : "game_bench.json";
+    int width = argc > 2 ? std::atoi(argv[2]) : 1024;
+    int height = argc > 3 ? std::atoi(argv[3]) : 1024;
+
+    hexMath();
+    hashLookups<HexHash>("lookup_HexHash");
+    hashLookups<std::hash<Hex>>("lookup_std_hash");
+    mapTraversal(width, height);
+    bool ok = true;
+#if BENCH_WITH_GAME
+    ok = renderFrames(width, height);
+#else
+    printf("built without SDL, no render or initMapSet benchmarks\n");
+#endif
+
+    FILE* out = fopen(jsonPath, "w");
+    if (out == nullptr) {
+        fprintf(stderr, "can't write %s\n", jsonPath);
+        return 1;
+    }
+    fprintf(out, "{");
+    for (size_t i = 0; i < results.size(); i++) {
+        fprintf(out, "%s\"%s\":{\"iterations\":%lld,\"ns_per_op\":%.4f}", i ? ",\n" : "", results[i].name.c_str(),
+                results[i].iterations, results[i].nsPerOp);
+    }
+    for (const auto& s : series) {
+        fprintf(out, ",\n");
+        s->writeJson(out);
+    }
+    fprintf(out, "}\n");
+    if (fclose(out) != 0) return 1;
+    printf("wrote %s\n", jsonPath);
+    return ok ? 0 : 1;
+}
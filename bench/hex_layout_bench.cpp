@@ -0,0 +1,122 @@
+// Microbenchmark for the hex <-> pixel conversions in hex.h.
+// Compares the old per-call functions (Layout by value, sqrt(3) every call) with the
+// precomputed scalar versions and the batch SoA versions, for both orientations.
+//
+// g++ -O2 -std=c++17 bench/hex_layout_bench.cpp -o hex_layout_bench && ./hex_layout_bench
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "../hex.h"
+
+// what hex_to_pixel/pixel_to_hex used to cost: copies of the layout and a sqrt per call
+struct OldLayout {
+    double f0, f1, f2, f3, b0, b1, b2, b3;
+    double sizeX, sizeY, originX, originY;
+};
+
+OldLayout oldLayout(bool flat, double sx, double sy) {
+    if (flat) return {3.0 / 2.0, 0.0, sqrt(3.0) / 2.0, sqrt(3.0), 2.0 / 3.0, 0.0, -1.0 / 3.0, sqrt(3.0) / 3.0, sx, sy, 0, 0};
+    return {sqrt(3.0), sqrt(3.0) / 2.0, 0.0, 3.0 / 2.0, sqrt(3.0) / 3.0, -1.0 / 3.0, 0.0, 2.0 / 3.0, sx, sy, 0, 0};
+}
+
+__attribute__((noinline)) Point old_hex_to_pixel(OldLayout layout, Hex h) {
+    volatile double three = 3.0; // the old code called sqrt(3) on every invocation
+    double f2 = layout.f2 == 0.0 ? 0.0 : sqrt(three) / 2;
+    double x = (layout.f0 * h.q + layout.f1 * h.r) * layout.sizeX;
+    double y = (f2 * h.q + layout.f3 * h.r) * layout.sizeY;
+    return Point(x + layout.originX, y + layout.originY);
+}
+
+__attribute__((noinline)) FracHex old_pixel_to_hex(OldLayout layout, Point p) {
+    volatile double three = 3.0;
+    double b3 = layout.b3 == 2.0 / 3.0 ? layout.b3 : sqrt(three) / 3;
+    double x = (p.x - layout.originX) / layout.sizeX;
+    double y = (p.y - layout.originY) / layout.sizeY;
+    double q = layout.b0 * x + layout.b1 * y;
+    double r = layout.b2 * x + b3 * y;
+    return FracHex(q, r, -q - r);
+}
+
+template <typename F>
+double timeNs(size_t n, int reps, F f) {
+    double best = 1e30;
+    for (int rep = 0; rep < reps; rep++) {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        auto end = std::chrono::steady_clock::now();
+        double ns = std::chrono::duration<double, std::nano>(end - start).count() / n;
+        if (ns < best) best = ns;
+    }
+    return best;
+}
+
+int main() {
+    const size_t n = 1 << 20;
+    const int reps = 10;
+    std::mt19937 gen(1234);
+    std::uniform_int_distribution<int> coord(-500, 500);
+    std::vector<int> q(n), r(n), outQ(n), outR(n);
+    std::vector<double> x(n), y(n), fq(n), fr(n);
+    for (size_t i = 0; i < n; i++) {
+        q[i] = coord(gen);
+        r[i] = coord(gen);
+    }
+    volatile double sink = 0;
+    int failures = 0;
+
+    for (int flat = 1; flat >= 0; flat--) {
+        const Layout layout(flat ? layout_flat : layout_pointy, Point(50, 57), Point(0, 0));
+        const OldLayout old = oldLayout(flat, 50, 57);
+        printf("%s layout, %zu hexes, best of %d\n", flat ? "flat" : "pointy", n, reps);
+
+        double oldToPixel = timeNs(n, reps, [&] {
+            double acc = 0;
+            for (size_t i = 0; i < n; i++) acc += old_hex_to_pixel(old, Hex(q[i], r[i])).x;
+            sink = acc;
+        });
+        double scalarToPixel = timeNs(n, reps, [&] {
+            double acc = 0;
+            for (size_t i = 0; i < n; i++) acc += hex_to_pixel(layout, Hex(q[i], r[i])).x;
+            sink = acc;
+        });
+        double batchToPixel = timeNs(n, reps, [&] {
+            hex_to_pixel(layout, q.data(), r.data(), x.data(), y.data(), n);
+        });
+
+        double oldToHex = timeNs(n, reps, [&] {
+            int acc = 0;
+            for (size_t i = 0; i < n; i++) acc += hex_round(old_pixel_to_hex(old, Point(x[i], y[i]))).q;
+            sink = acc;
+        });
+        double scalarToHex = timeNs(n, reps, [&] {
+            int acc = 0;
+            for (size_t i = 0; i < n; i++) acc += hex_round(pixel_to_hex(layout, Point(x[i], y[i]))).q;
+            sink = acc;
+        });
+        double batchToHex = timeNs(n, reps, [&] {
+            pixel_to_hex(layout, x.data(), y.data(), fq.data(), fr.data(), n);
+            hex_round(fq.data(), fr.data(), outQ.data(), outR.data(), n);
+        });
+
+        // the batch forms have to agree with the scalar ones and round trip exactly
+        for (size_t i = 0; i < n; i++) {
+            Point p = hex_to_pixel(layout, Hex(q[i], r[i]));
+            Point o = old_hex_to_pixel(old, Hex(q[i], r[i]));
+            if (std::abs(p.x - x[i]) > 1e-9 || std::abs(p.y - y[i]) > 1e-9 ||
+                std::abs(p.x - o.x) > 1e-6 || std::abs(p.y - o.y) > 1e-6 ||
+                outQ[i] != q[i] || outR[i] != r[i]) {
+                failures++;
+            }
+        }
+
+        printf("  hex_to_pixel  old %6.2f ns  scalar %6.2f ns  batch %6.2f ns\n", oldToPixel, scalarToPixel, batchToPixel);
+        printf("  pixel_to_hex  old %6.2f ns  scalar %6.2f ns  batch %6.2f ns  (including hex_round)\n", oldToHex, scalarToHex, batchToHex);
+    }
+
+    if (failures != 0) {
+        printf("MISMATCH: %d conversions disagree\n", failures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,106 @@
+// Benchmark for HexPathfinder on a big random map.
+// Runs batches of A* queries and movement range queries (like a turn with lots of units) and
+// checks A* against the range search so a broken heuristic shows up as a failure.
+//
+// g++ -O2 -std=c++17 bench/pathfinding_bench.cpp -o pathfinding_bench && ./pathfinding_bench [width height]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "../pathfinding.h"
+
+int main(int argc, char* argv[]) {
+    int width = argc > 2 ? std::atoi(argv[1]) : 512;
+    int height = argc > 2 ? std::atoi(argv[2]) : 512;
+
+    TileRegistry terrain;
+    TileRegistry decorations;
+    TileKindId plain = terrain.add("plain");
+    TileKindId swamp = terrain.add("swamp");
+    terrain.kind(swamp).moveCost = 2;
+    TileKindId tree = decorations.add("tree");
+    decorations.kind(tree).moveCost = 1;
+    TileKindId rock = decorations.add("rock");
+    decorations.kind(rock).blocksMove = true;
+
+    HexMap map(width, height);
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<> dis(0.0, 1.0);
+    for (auto cell : map) {
+        cell.tile.terrain = dis(gen) > 0.8 ? swamp : plain;
+        double roll = dis(gen);
+        if (roll > 0.85) cell.tile.decoration = rock;
+        else if (roll > 0.7) cell.tile.decoration = tree;
+    }
+    TerrainCost cost(map, terrain, decorations);
+    HexPathfinder pathfinder;
+    std::vector<int> path;
+    std::vector<int> reachable;
+
+    // pick open tiles for the queries
+    std::vector<int> open;
+    for (int i = 0; i < map.size(); i++) {
+        if (cost(i) != PATH_BLOCKED) open.push_back(i);
+    }
+    std::uniform_int_distribution<size_t> pick(0, open.size() - 1);
+    printf("map %dx%d (%d tiles)\n", width, height, map.size());
+
+    // short hops, what units do every turn
+    const int shortQueries = 20000;
+    std::vector<std::pair<int, int>> shortPairs;
+    while (static_cast<int>(shortPairs.size()) < shortQueries) {
+        int a = open[pick(gen)];
+        Hex h = map.hexAt(a);
+        int b = map.index(Hex(h.q + static_cast<int>(gen() % 21) - 10, h.r + static_cast<int>(gen() % 21) - 10));
+        if (b >= 0 && cost(b) != PATH_BLOCKED) shortPairs.push_back({a, b});
+    }
+    auto start = std::chrono::steady_clock::now();
+    int found = 0;
+    for (auto& pair : shortPairs) found += pathfinder.findPath(map, pair.first, pair.second, cost, path);
+    double shortUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    printf("A* short (<=10 hexes apart): %d queries, %.2f us/query, %d found\n", shortQueries, shortUs / shortQueries, found);
+
+    // long paths across the map
+    const int longQueries = 200;
+    start = std::chrono::steady_clock::now();
+    found = 0;
+    for (int i = 0; i < longQueries; i++) found += pathfinder.findPath(map, open[pick(gen)], open[pick(gen)], cost, path);
+    double longUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    printf("A* across the map:           %d queries, %.2f us/query, %d found\n", longQueries, longUs / longQueries, found);
+
+    // movement ranges for a wave of units
+    for (int movePoints : {4, 8, 16}) {
+        const int units = 5000;
+        start = std::chrono::steady_clock::now();
+        size_t tiles = 0;
+        for (int i = 0; i < units; i++) {
+            pathfinder.movementRange(map, open[pick(gen)], movePoints, cost, reachable);
+            tiles += reachable.size();
+        }
+        double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        printf("movement range %2d MP:       %d units, %.2f us/unit, %.1f tiles avg\n", movePoints, units, us / units, double(tiles) / units);
+    }
+
+    // A* has to agree with the range search (which is plain Dijkstra) about path costs
+    int failures = 0;
+    for (int i = 0; i < 500; i++) {
+        int from = open[pick(gen)];
+        pathfinder.movementRange(map, from, 12, cost, reachable);
+        if (reachable.empty()) continue;
+        int to = reachable[gen() % reachable.size()];
+        int expected = pathfinder.costTo(to);
+        if (!pathfinder.findPath(map, from, to, cost, path)) {
+            failures++;
+            continue;
+        }
+        int total = 0;
+        for (int step : path) total += cost(step);
+        if (total != expected) failures++;
+    }
+    if (failures != 0) {
+        printf("MISMATCH: %d paths disagree with the range search\n", failures);
+        return 1;
+    }
+    return 0;
+}
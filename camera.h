@@ -0,0 +1,92 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "hex.h"
+#include "hexmap.h"
+
+// The part of the world that's on screen, in world pixels.
+struct Camera {
+    double x = 0;
+    double y = 0;
+    int w = 800;
+    int h = 600;
+
+    // layout with the camera offset baked into the origin, so hex_to_pixel gives screen coordinates
+    Layout screenLayout(const Layout& world) const {
+        return Layout(world.orientation, world.size, Point(world.origin.x - x, world.origin.y - y));
+    }
+};
+
+// Calls visit(index, hex) for every map tile whose sprite rectangle (spriteW x spriteH, anchored at
+// hex_to_pixel) overlaps the camera. The range is solved from the layout directly instead of testing
+// every tile, so the cost depends on how many tiles fit on screen and not on the size of the map.
+// Works for both orientations: flat topped maps go column by column (x only depends on q), pointy
+// topped ones row by row (y only depends on r).
+template <typename Visit>
+void forEachVisibleHex(const HexMap& map, const Layout& layout, const Camera& camera, int spriteW, int spriteH, Visit visit) {
+    if (map.size() == 0) return;
+    // visible window relative to the layout origin, grown by the sprite size since sprites hang right/down from their anchor
+    double minX = camera.x - spriteW - layout.origin.x;
+    double maxX = camera.x + camera.w - layout.origin.x;
+    double minY = camera.y - spriteH - layout.origin.y;
+    double maxY = camera.y + camera.h - layout.origin.y;
+
+    // map bounds in the rectangle storage: q in [0, width), r + floor(q/2) in [0, height)
+    if (layout.px1 == 0.0) {
+        // flat: x = px0*q, y = py0*q + py1*r
+        int q0 = std::max(0, static_cast<int>(std::floor(minX / layout.px0)));
+        int q1 = std::min(map.width() - 1, static_cast<int>(std::ceil(maxX / layout.px0)));
+        for (int q = q0; q <= q1; q++) {
+            int r0 = static_cast<int>(std::floor((minY - layout.py0 * q) / layout.py1));
+            int r1 = static_cast<int>(std::ceil((maxY - layout.py0 * q) / layout.py1));
+            r0 = std::max(r0, -(q >> 1));
+            r1 = std::min(r1, map.height() - 1 - (q >> 1));
+            for (int r = r0; r <= r1; r++) {
+                visit(map.index(q, r), Hex(q, r));
+            }
+        }
+    } else {
+        // pointy: y = py1*r, x = px0*q + px1*r
+        int rMin = -((map.width() - 1) >> 1);
+        int rMax = map.height() - 1;
+        int r0 = std::max(rMin, static_cast<int>(std::floor(minY / layout.py1)));
+        int r1 = std::min(rMax, static_cast<int>(std::ceil(maxY / layout.py1)));
+        for (int r = r0; r <= r1; r++) {
+            int qa = std::max(0, static_cast<int>(std::floor((minX - layout.px1 * r) / layout.px0)));
+            int qb = std::min(map.width() - 1, static_cast<int>(std::ceil((maxX - layout.px1 * r) / layout.px0)));
+            for (int q = qa; q <= qb; q++) {
+                int i = map.index(q, r);
+                if (i >= 0) visit(i, Hex(q, r));
+            }
+        }
+    }
+}
+
+// The visible tiles as parallel arrays (map index, axial q/r and the pixel anchor of each),
+// so the pixel positions can be computed with the batch hex_to_pixel in one go.
+// Keep one around between frames, the vectors keep their capacity.
+struct VisibleHexes {
+    std::vector<int> index;
+    std::vector<int> q;
+    std::vector<int> r;
+    std::vector<double> x;
+    std::vector<double> y;
+
+    size_t size() const { return index.size(); }
+};
+
+inline void collectVisibleHexes(const HexMap& map, const Layout& layout, const Camera& camera, int spriteW, int spriteH, VisibleHexes& out) {
+    out.index.clear();
+    out.q.clear();
+    out.r.clear();
+    forEachVisibleHex(map, layout, camera, spriteW, spriteH, [&](int i, Hex h) {
+        out.index.push_back(i);
+        out.q.push_back(h.q);
+        out.r.push_back(h.r);
+    });
+    out.x.resize(out.size());
+    out.y.resize(out.size());
+    hex_to_pixel(layout, out.q.data(), out.r.data(), out.x.data(), out.y.data(), out.size());
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <algorithm>
+#include "hex.h"
+#include "hexmap.h"
+#include "entities.h"
+#include "visibility.h"
+#include "rng.h"
+
+// Attack resolution. No SDL and no globals: everything comes in as arguments (the map, the units, a dice
+// stream), so the game, the batch simulator (tools/simulate.cpp) and tests all run the same rules.
+
+struct WeaponStats {
+    const char* name;
+    int aim;            // percent to hit an adjacent target in the open
+    int range;          // tiles, 0 chance past it
+    int damageDice;     // damage is damageDice d damageSides + damageBonus
+    int damageSides;
+    int damageBonus;
+};
+
+const WeaponStats CLASS_WEAPONS[CLASS_COUNT] = {
+    //  name          aim  range  dice   bonus
+    {"crossbow",      75,  8,     1, 8,  2},   // archer
+    {"explosives",    60,  4,     2, 6,  0},   // heavy
+    {"shotgun",       70,  3,     2, 4,  2},   // assault
+    {"pistol",        65,  5,     1, 6,  0},   // hacker
+    {"pistol",        60,  5,     1, 6,  0},   // medic
+    {"pitchfork",     55,  1,     1, 4,  0},   // peasant
+};
+
+const int COVER_AIM_PENALTY[3] = {0, 20, 40};  // by CoverLevel
+const int AIM_FALLOFF_PER_TILE = 5;            // past the first tile
+const int MIN_HIT_CHANCE = 5;
+const int MAX_HIT_CHANCE = 95;
+
+// Percent chance to hit. 0 if the target is out of range.
+inline int hitChance(UnitClass attacker, int distance, int cover) {
+    const WeaponStats& weapon = CLASS_WEAPONS[attacker];
+    if (distance > weapon.range || distance < 1) return 0;
+    int chance = weapon.aim - AIM_FALLOFF_PER_TILE * (distance - 1);
+    if (!CLASS_STATS[attacker].ignoresCover) chance -= COVER_AIM_PENALTY[cover];
+    return std::min(MAX_HIT_CHANCE, std::max(MIN_HIT_CHANCE, chance));
+}
+
+struct AttackResult {
+    int chance;   // what it was rolled against
+    bool hit;
+    int damage;   // 0 on a miss
+};
+
+// Rolls one attack with a known hit chance.
+inline AttackResult rollAttack(UnitClass attacker, int chance, Pcg32& rng) {
+    AttackResult result = {chance, false, 0};
+    if (chance <= 0) return result;
+    result.hit = rng.percent(chance);
+    if (result.hit) {
+        const WeaponStats& weapon = CLASS_WEAPONS[attacker];
+        result.damage = rng.roll(weapon.damageDice, weapon.damageSides) + weapon.damageBonus;
+    }
+    return result;
+}
+
+// Hit chance of a unit of class cls standing on tile from at whatever is on tile to: range, line of
+// sight (archers shoot past obstacles too) and cover. Works for tiles nobody is on yet, which is what
+// the AI needs to weigh moves.
+template <typename Sight>
+int tileAttackChance(const HexMap& map, UnitClass cls, int from, int to, const Sight& sight) {
+    int distance = hex_distance(map.hexAt(from), map.hexAt(to));
+    if (distance > CLASS_WEAPONS[cls].range) return 0;
+    if (!CLASS_STATS[cls].ignoresCover && !lineOfSight(map, from, to, sight)) return 0;
+    return hitChance(cls, distance, coverAgainst(map, from, to, sight));
+}
+
+// Average damage of a hit.
+inline float meanDamage(UnitClass cls) {
+    const WeaponStats& weapon = CLASS_WEAPONS[cls];
+    return weapon.damageDice * (weapon.damageSides + 1) * 0.5f + weapon.damageBonus;
+}
+
+// Hit chance of one unit shooting at another on the map. Slots are EntityStore dense slots.
+template <typename Sight>
+int attackChance(const HexMap& map, const EntityStore& units, int attacker, int target, const Sight& sight) {
+    return tileAttackChance(map, units.unitClass[attacker], units.tile[attacker], units.tile[target], sight);
+}
+
+// Rolls an attack and applies its damage. Deaths (and heavies blowing up) are left to
+// EntityStore::processDeaths so a whole volley can resolve before anyone is removed.
+template <typename Sight>
+AttackResult attack(const HexMap& map, EntityStore& units, int attacker, int target, const Sight& sight, Pcg32& rng) {
+    AttackResult result = rollAttack(units.unitClass[attacker], attackChance(map, units, attacker, target, sight), rng);
+    units.health[target] -= result.damage;
+    return result;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <SDL.h>
+#include "profiler.h"
+
+// SDL's drawing calls, each counted as a PROFILE_DRAW_CALLS where it's made. Draw through these rather
+// than SDL_Render* directly, so the profiler's count is what was actually drawn and can't drift from it
+// the way counts kept by hand next to the calls did.
+
+inline int renderCopy(SDL_Renderer* renderer, SDL_Texture* texture, const SDL_Rect* src, const SDL_Rect* dest) {
+    PROFILE_COUNT(PROFILE_DRAW_CALLS, 1);
+    return SDL_RenderCopy(renderer, texture, src, dest);
+}
+
+inline int renderFillRect(SDL_Renderer* renderer, const SDL_Rect* rect) {
+    PROFILE_COUNT(PROFILE_DRAW_CALLS, 1);
+    return SDL_RenderFillRect(renderer, rect);
+}
+
+inline int renderGeometry(SDL_Renderer* renderer, SDL_Texture* texture, const SDL_Vertex* vertices, int vertexCount,
+                          const int* indices, int indexCount) {
+    PROFILE_COUNT(PROFILE_DRAW_CALLS, 1);
+    return SDL_RenderGeometry(renderer, texture, vertices, vertexCount, indices, indexCount);
+}
+
+inline int renderClear(SDL_Renderer* renderer) {
+    PROFILE_COUNT(PROFILE_DRAW_CALLS, 1);
+    return SDL_RenderClear(renderer);
+}
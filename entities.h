@@ -0,0 +1,265 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "hex.h"
+#include "hexmap.h"
+
+// Units (player and enemies) stored as structure-of-arrays.
+// Each component is its own contiguous array indexed by the same dense slot, so turn processing
+// (damage, movement points, deaths) sweeps plain arrays. Units are referred to by EntityHandles,
+// which stay valid while the dense arrays get compacted underneath, and go stale when the unit dies.
+// Every tile with units on it also has a list of them, so "what's on this tile" is O(1). The lists' heads
+// are in a hash map by tile, not an array over the map, the store costs what its units do and not what the map does.
+
+// the class system from the README
+enum UnitClass : uint8_t {
+    CLASS_ARCHER,
+    CLASS_HEAVY,
+    CLASS_ASSAULT,
+    CLASS_HACKER,
+    CLASS_MEDIC,
+    CLASS_PEASANT,
+    CLASS_COUNT
+};
+
+struct ClassStats {
+    const char* name;
+    int maxHealth;
+    int movePoints;
+    int sightRange;        // in tiles
+    bool ignoresCover;     // archers shoot past cover and obstacles
+    bool explodesOnDeath;  // heavies take their neighbors with them
+    bool healsAdjacent;    // medics
+    bool hacksRobots;      // hackers
+};
+
+const ClassStats CLASS_STATS[CLASS_COUNT] = {
+    //  name       hp  mp  sight  cover  boom   heal   hack
+    {"archer",     10, 5,  8,     true,  false, false, false},
+    {"heavy",      14, 2,  5,     false, true,  false, false},
+    {"assault",    12, 6,  6,     false, false, false, false},
+    {"hacker",     7,  4,  6,     false, false, false, true},
+    {"medic",      14, 4,  5,     false, false, true,  false},
+    {"peasant",    5,  3,  4,     false, false, false, false},
+};
+
+const int HEAVY_EXPLOSION_DAMAGE = 6;
+
+enum Team : uint8_t {
+    TEAM_PLAYER,
+    TEAM_ENEMY
+};
+
+struct EntityHandle {
+    uint32_t id = UINT32_MAX;  // sparse slot, reused after the unit dies
+    uint32_t generation = 0;   // bumped every time the slot is reused so old handles go stale
+
+    bool operator==(const EntityHandle& other) const { return id == other.id && generation == other.generation; }
+    bool operator!=(const EntityHandle& other) const { return !(*this == other); }
+};
+
+const int NO_ENTITY = -1;
+
+class EntityStore {
+public:
+    // components, indexed by dense slot [0, count()). Read them directly in sweeps,
+    // but go through move() to change tile so the tile index stays in sync.
+    std::vector<int> tile;          // map index the unit stands on
+    std::vector<int> health;
+    std::vector<int> movePoints;    // left this turn
+    std::vector<UnitClass> unitClass;
+    std::vector<Team> team;
+    std::vector<int> animClip;      // clip playing (animation.h), -1 for none
+    std::vector<float> animTime;    // seconds into that clip
+    std::vector<uint32_t> idOf;     // dense slot -> sparse id, for making handles
+
+    int count() const { return static_cast<int>(tile.size()); }
+
+    // call whenever the map is (re)created, units are kept but their tiles must still be on the map
+    void resizeMap(int tileCount) {
+        mapTiles = tileCount;
+        occupantHead.clear();
+        occupantHead.reserve(tile.size());
+        for (int i = 0; i < count(); i++) linkTile(idOf[i], tile[i]);
+    }
+
+    EntityHandle spawn(Team side, UnitClass cls, int tileIndex) {
+        uint32_t id;
+        if (!freeIds.empty()) {
+            id = freeIds.back();
+            freeIds.pop_back();
+        } else {
+            id = static_cast<uint32_t>(denseOf.size());
+            denseOf.push_back(NO_ENTITY);
+            generations.push_back(0);
+            occupantNext.push_back(NO_ENTITY);
+        }
+        denseOf[id] = count();
+        tile.push_back(tileIndex);
+        health.push_back(CLASS_STATS[cls].maxHealth);
+        movePoints.push_back(CLASS_STATS[cls].movePoints);
+        unitClass.push_back(cls);
+        team.push_back(side);
+        animClip.push_back(-1);
+        animTime.push_back(0.0f);
+        idOf.push_back(id);
+        linkTile(id, tileIndex);
+        return EntityHandle{id, generations[id]};
+    }
+
+    bool alive(EntityHandle h) const {
+        return h.id < generations.size() && generations[h.id] == h.generation && denseOf[h.id] != NO_ENTITY;
+    }
+
+    // dense slot of a live unit, NO_ENTITY for stale handles
+    int slot(EntityHandle h) const {
+        return alive(h) ? denseOf[h.id] : NO_ENTITY;
+    }
+
+    EntityHandle handle(int slotIndex) const {
+        uint32_t id = idOf[slotIndex];
+        return EntityHandle{id, generations[id]};
+    }
+
+    void move(int slotIndex, int tileIndex) {
+        uint32_t id = idOf[slotIndex];
+        unlinkTile(id, tile[slotIndex]);
+        tile[slotIndex] = tileIndex;
+        linkTile(id, tileIndex);
+    }
+
+    // Removes a unit, the last unit is swapped into its slot so the arrays stay packed.
+    void destroy(EntityHandle h) {
+        int s = slot(h);
+        if (s == NO_ENTITY) return;
+        unlinkTile(h.id, tile[s]);
+        int last = count() - 1;
+        if (s != last) {
+            tile[s] = tile[last];
+            health[s] = health[last];
+            movePoints[s] = movePoints[last];
+            unitClass[s] = unitClass[last];
+            team[s] = team[last];
+            animClip[s] = animClip[last];
+            animTime[s] = animTime[last];
+            idOf[s] = idOf[last];
+            denseOf[idOf[s]] = s;
+        }
+        tile.pop_back();
+        health.pop_back();
+        movePoints.pop_back();
+        unitClass.pop_back();
+        team.pop_back();
+        animClip.pop_back();
+        animTime.pop_back();
+        idOf.pop_back();
+        denseOf[h.id] = NO_ENTITY;
+        generations[h.id]++;
+        freeIds.push_back(h.id);
+    }
+
+    // first unit on a tile (dense slot), NO_ENTITY if the tile is empty
+    int occupant(int tileIndex) const {
+        auto head = occupantHead.find(tileIndex);
+        return head == occupantHead.end() ? NO_ENTITY : denseOf[head->second];
+    }
+
+    // calls visit(slot) for every unit on a tile
+    template <typename Visit>
+    void forEachOnTile(int tileIndex, Visit visit) const {
+        auto head = occupantHead.find(tileIndex);
+        if (head == occupantHead.end()) return;
+        for (int id = head->second; id != NO_ENTITY; id = occupantNext[id]) visit(denseOf[id]);
+    }
+
+    // start of a team's turn
+    void resetMovePoints(Team side) {
+        for (int i = 0; i < count(); i++) {
+            if (team[i] == side) movePoints[i] = CLASS_STATS[unitClass[i]].movePoints;
+        }
+    }
+
+    void damageTile(int tileIndex, int amount) {
+        forEachOnTile(tileIndex, [&](int s) { health[s] -= amount; });
+    }
+
+    // Removes every unit at 0 health. Heavies explode when they go down, which can take out their
+    // neighbors too, so this keeps sweeping until nothing else dies. Returns how many died.
+    int processDeaths(const HexMap& map) {
+        int deaths = 0;
+        for (;;) {
+            dying.clear();
+            for (int i = 0; i < count(); i++) {
+                if (health[i] <= 0) dying.push_back(handle(i));
+            }
+            if (dying.empty()) break;
+            for (EntityHandle h : dying) {
+                int s = slot(h);
+                if (CLASS_STATS[unitClass[s]].explodesOnDeath) {
+                    int at = tile[s];
+                    destroy(h);
+                    damageTile(at, HEAVY_EXPLOSION_DAMAGE);
+                    for (int d = 0; d < 6; d++) damageTile(map.neighbor(at, d), HEAVY_EXPLOSION_DAMAGE);
+                } else {
+                    destroy(h);
+                }
+                deaths++;
+            }
+        }
+        return deaths;
+    }
+
+    // The handle bookkeeping, so snapshots and saves (snapshot.h, savegame.h) can put a store back
+    // together with every handle into it still meaning the same unit.
+    struct Sparse {
+        std::vector<int> denseOf;
+        std::vector<uint32_t> generations;
+        std::vector<uint32_t> freeIds;
+
+        bool operator==(const Sparse& other) const {
+            return denseOf == other.denseOf && generations == other.generations && freeIds == other.freeIds;
+        }
+    };
+    Sparse sparse() const { return Sparse{denseOf, generations, freeIds}; }
+
+    // Call after filling in the components: takes the handle bookkeeping and rebuilds the tile lists.
+    void restore(const Sparse& s, int tileCount) {
+        denseOf = s.denseOf;
+        generations = s.generations;
+        freeIds = s.freeIds;
+        occupantNext.assign(denseOf.size(), NO_ENTITY);
+        resizeMap(tileCount);
+    }
+
+private:
+    void linkTile(uint32_t id, int tileIndex) {
+        if (tileIndex < 0 || tileIndex >= mapTiles) {
+            occupantNext[id] = NO_ENTITY;
+            return;
+        }
+        auto head = occupantHead.emplace(tileIndex, NO_ENTITY).first;
+        occupantNext[id] = head->second;
+        head->second = static_cast<int>(id);
+    }
+
+    void unlinkTile(uint32_t id, int tileIndex) {
+        auto head = occupantHead.find(tileIndex);
+        if (head == occupantHead.end()) return;
+        int* link = &head->second;
+        while (*link != NO_ENTITY && *link != static_cast<int>(id)) link = &occupantNext[*link];
+        if (*link != NO_ENTITY) *link = occupantNext[id];
+        if (head->second == NO_ENTITY) occupantHead.erase(head); // empty tiles have no entry
+    }
+
+    // sparse side, indexed by handle id
+    std::vector<int> denseOf;          // NO_ENTITY when the id is free
+    std::vector<uint32_t> generations;
+    std::vector<int> occupantNext;     // next id on the same tile
+    std::vector<uint32_t> freeIds;
+
+    int mapTiles = 0;
+    std::unordered_map<int, int> occupantHead; // tile -> first id standing on it, only tiles with units
+    std::vector<EntityHandle> dying;   // scratch for processDeaths
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <chrono>
+#include <thread>
+
+// Fixed timestep simulation with variable rate rendering.
+// https://gafferongames.com/post/fix_your_timestep/
+// The game logic always advances in ticks of exactly tickSeconds() no matter how fast frames come,
+// the renderer interpolates between the last two ticks with alpha(), and endFrame() sleeps off
+// whatever is left of the frame budget when a target fps is set.
+class FrameClock {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    // targetFps <= 0 means don't cap (vsync, if it's on, still does)
+    FrameClock(int ticksPerSecond, int targetFps)
+    : tick(1.0 / ticksPerSecond), frameBudget(targetFps > 0 ? 1.0 / targetFps : 0.0),
+      accumulator(0.0), lastFrame(Clock::now()), frameStart(lastFrame) {}
+
+    // Measures the time since the last frame and returns how many simulation ticks to run now.
+    int beginFrame() {
+        frameStart = Clock::now();
+        double elapsed = std::chrono::duration<double>(frameStart - lastFrame).count();
+        lastFrame = frameStart;
+        // after a long stall (breakpoint, window drag) don't try to catch up on seconds of ticks
+        if (elapsed > maxFrameSeconds) elapsed = maxFrameSeconds;
+        accumulator += elapsed;
+        int ticks = static_cast<int>(accumulator / tick);
+        accumulator -= ticks * tick;
+        return ticks;
+    }
+
+    // how far between the previous and the current tick the frame being drawn is, 0..1
+    double alpha() const { return accumulator / tick; }
+
+    double tickSeconds() const { return tick; }
+
+    // Sleeps until the frame budget is used up. Sleeps a bit short and spins the rest so the
+    // scheduler's coarse wakeups don't make us miss the deadline.
+    void endFrame() {
+        if (frameBudget <= 0.0) return;
+        Clock::time_point deadline = frameStart + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(frameBudget));
+        Clock::time_point sleepUntil = deadline - std::chrono::milliseconds(1);
+        if (Clock::now() < sleepUntil) std::this_thread::sleep_until(sleepUntil);
+        while (Clock::now() < deadline) {
+            std::this_thread::yield();
+        }
+    }
+
+private:
+    const double maxFrameSeconds = 0.25;
+    double tick;
+    double frameBudget;
+    double accumulator;
+    Clock::time_point lastFrame;
+    Clock::time_point frameStart;
+};
@@ -0,0 +1,1106 @@
+// The game: everything but the command line, which is main.cpp's. Built as a library (CMakeLists.txt) so
+// the benchmarks can drive the same code, game.h is what they get to see.
+// game.cpp is the one place the profiler's allocation counter (operator new) gets defined
+#define PROFILE_DEFINE_ALLOC_HOOK
+#include <SDL.h>
+#include <SDL_image.h>
+#include <memory>
+#include <vector>
+#include <array>
+#include <random>
+#include <SDL_ttf.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <string>
+#include "hex.h"
+#include "hexmap.h"
+#include "terrain.h"
+#include "camera.h"
+#include "sprites.h"
+#include "picking.h"
+#include "frameloop.h"
+#include "pathfinding.h"
+#include "entities.h"
+#include "visibility.h"
+#include "mapfile.h"
+#include "threadpool.h"
+#include "assets.h"
+#include "animation.h"
+#include "rng.h"
+#include "combat.h"
+#include "ai.h"
+#include "mapgen.h"
+#include "text.h"
+#include "uilayer.h"
+#include "parallax.h"
+#include "replay.h"
+#include "savegame.h"
+#include "profiler.h"
+#include "drawcalls.h"
+#include "log.h"
+#include "game.h"
+
+// all the randomness, one stream each for combat, map generation and cosmetics (rng.h).
+// seeded from --seed, or randomly with the seed logged so a run can be repeated
+Dice dice;
+
+SDL_Window* window;
+SDL_Renderer* renderer;
+SDL_Event event;
+bool isRunning = true;
+bool mapMode = true;
+enum shotStates {
+    HIT,
+    MISS,
+    PRESHOT 
+};
+shotStates shotState = PRESHOT;
+int cursorX;
+int cursorY;
+std::array<int, 2> activePos;
+TTF_Font* fontReg;
+TTF_Font* fontBold;
+GlyphAtlas boldGlyphs; // glyphs of fontBold, built once the renderer exists
+TextCache textCache;
+int shotChance;
+EntityHandle shotTarget; // unit on the selected tile when 'g' was pressed
+bool fullscreen = false;
+int numCols;
+int numRows;
+GameOptions gameOptions; // what startGame was called with
+
+// should be in the file's header but oh well
+HexMap mapSet;
+MapFile mapFile;       // set with --map, mapSet sits on top of it instead of being built by initMapSet
+BiomeKinds biomes;     // what initMapSet's generator places
+int generateWidth = 10; // size of the generated map, --generate W H
+int generateHeight = 5;
+std::vector<int> objectives; // objective tiles of the generated map
+std::unique_ptr<ThreadPool> workers;
+ThreadPool* workerPool = nullptr; // for asset loading, map generation and the enemy AI
+AiPlanner enemyAi;
+std::vector<AiOrder> enemyOrders;
+MapStreamer mapStreamer; // pages the chunks around the camera in for mapped maps
+TileRegistry terrainTypes;
+TileRegistry decorationTypes;
+Camera camera;
+EntityStore units;          // the player's squad and every enemy
+EntityHandle playerOne;
+VisibilityCache visibility; // what each unit sees, only recomputed when the unit moves
+// the player's units MARK_VISIBLE was last built for. One dying, or a different squad after an undo or a
+// load, changes what's visible without any field of view being recomputed
+std::vector<EntityHandle> visibleMarksFor;
+bool visibleMarksValid = false; // false until built for this map and these units, even when that's no units
+std::vector<EntityHandle> playerUnits; // this frame's, scratch
+HexPathfinder pathfinder; // search buffers are reused between queries
+std::vector<int> npcPath;  // same for the path moveNPC walks
+Camera previousCamera; // camera as of the tick before, the renderer interpolates between the two
+const double cameraPanSpeed = 600; // pixels per second while an arrow key is held
+
+// frame pacing, can be changed with --tick-rate, --fps and --no-vsync
+int tickRate = 60;  // simulation ticks per second, fixed no matter the frame rate
+int targetFps = 60; // 0 = uncapped
+bool vsync = true;
+bool showProfiler = false;   // F3, needs a build with PROFILE_ENABLED
+const char* tracePath = "profile-trace.json"; // F4 writes the profiler's frames here, --trace changes it
+
+// everything drawn on the map comes out of one atlas and is drawn a layer at a time
+TextureAtlas tileAtlas;
+int highlightSprite = -1;
+struct TileLayers {
+    SpriteBatch ground;
+    SpriteBatch highlight;
+    SpriteBatch decoration;
+    SpriteBatch labels; // drawn with the glyph atlas instead
+    SpriteBatch unitSprites; // every unit's current animation frame, from unitAtlas
+};
+TileLayers tileLayers;
+VisibleHexes visibleHexes;
+
+// notice the values 50,57 for the tile size. I found these values through trial and error. We need to find a way to calculate these values based on the tile .png dimensions, or etc.
+constexpr Layout mapLayout(layout_flat, Point(50,57), Point(0,0));
+const Point tileCenter(50, 50); // center of a 100x100 tile sprite relative to its hex_to_pixel anchor
+
+// unit animations, all frames of all clips share one atlas so the units are a single draw call
+TextureAtlas unitAtlas;
+AnimationLibrary animations;
+struct UnitSprite {
+    float depth; // bottom edge on screen, for sorting
+    int region;
+    SDL_FRect dest;
+};
+std::vector<UnitSprite> unitSprites;
+
+// everything in assets/manifest.txt, looked up by name once it's loaded
+AssetManager assets;
+AssetHandle fightAttacker = NO_ASSET;
+AssetHandle fightTarget = NO_ASSET;
+AssetHandle fightButtons[6] = {NO_ASSET, NO_ASSET, NO_ASSET, NO_ASSET, NO_ASSET, NO_ASSET};
+
+// The fight screen is two cached layers (uilayer.h): everything that only changes with the shot state,
+// and the "chance to hit" text, which flashes a new color every frame by tinting its layer instead of
+// being redrawn. An idle fight screen is two copies a frame.
+ComposedLayer fightBackground;
+ComposedLayer fightText;
+shotStates composedShotState = PRESHOT;
+int composedShotChance = -1;
+
+// the map's parallax background (parallax.h, assets/parallax.txt), picked by location when a map is started
+ParallaxLibrary backgrounds;
+
+// hovered/selected tiles, resolved in handleInput and read by the renderer
+Picking picking;
+
+// Input goes through commands (replay.h): handleInput turns this frame's SDL events into commands,
+// or takes them from a replay, and only applyCommand acts on them. --record writes them to a file,
+// --replay plays one back (with --headless or --offscreen for CI runs without a display).
+ReplayRecorder recorder;
+ReplayPlayer player;
+const char* recordPath = nullptr;
+bool replaying = false;
+bool headless = false;  // replay without rendering at all
+// enemy turns in recordings are planned with a fixed amount of work rather than a time budget (ai.h),
+// so a replay on another machine, or the same one under load, plans the same turn
+const int recordedAiPlayouts = 32;
+int aiPlayouts = 0;     // per option, 0 for the time budget
+uint32_t frameNumber = 0;
+int streamTicks = -1;   // simulation ticks as of the last CMD_TICKS
+int panX = 0;           // arrow keys held, -1..1, set by CMD_PAN
+int panY = 0;
+std::vector<Command> frameCommands;
+// only filled in during replays
+FrameTimings* frameTimings = nullptr;
+FrameTimings* tileTimings = nullptr;
+FrameTimings* fightTimings = nullptr;
+FrameTimings replayFrames("frame");
+FrameTimings replayTiles("tiles");
+FrameTimings replayFight("fight ui");
+
+// Every player turn starts with a snapshot (savegame.h): it goes on the undo history and is autosaved in
+// the background. Snapshots share whatever the turn didn't change with the one before.
+uint32_t turn = 0;
+UndoHistory undoHistory;
+SaveWriter saveWriter;
+const char* autosavePath = "autosave.sav"; // nullptr: turns still go on the undo history, just not to disk
+const char* quicksavePath = "quicksave.sav";
+std::unique_ptr<GameSnapshot> quicksave; // this session's, F9 doesn't wait for it to be written to load it
+std::vector<std::string> terrainNames; // what saves are checked against, filled in once the kinds are registered
+std::vector<std::string> decorationNames;
+
+// Moves an npc up to movePoints worth of tiles along the cheapest path toward a target tile.
+// objIndex is the npc's map index and is updated in place. Returns false if there's no path at all,
+// the npc stays put in that case.
+bool moveNPC(int& objIndex, int targetIndex, int movePoints) {
+    TerrainCost cost(mapSet, terrainTypes, decorationTypes);
+    if (!pathfinder.findPath(mapSet, objIndex, targetIndex, cost, npcPath)) {
+        return false;
+    }
+    int spent = 0;
+    for (int step : npcPath) {
+        spent += cost(step);
+        if (spent > movePoints) break;
+        objIndex = step;
+    }
+    return true;
+}
+
+void HandleMouseClick() {
+    // Move the character to the adjacent tile that was clicked, if it has the movement points for it.
+    int p = units.slot(playerOne);
+    if (p == NO_ENTITY || picking.hovered < 0) return;
+    if (hex_distance(mapSet.hexAt(units.tile[p]), mapSet.hexAt(picking.hovered)) != 1) return;
+    int step = TerrainCost(mapSet, terrainTypes, decorationTypes)(picking.hovered);
+    if (step == PATH_BLOCKED || step > units.movePoints[p]) return;
+    units.movePoints[p] -= step;
+    units.move(p, picking.hovered);
+    animations.play(units, p, animations.moveClip(units.unitClass[p]));
+}
+
+// 'e' ends the player's turn: the enemy team is planned on the worker pool and carried out right away
+void runEnemyTurn() {
+    PROFILE_ZONE("enemy turn");
+    units.resetMovePoints(TEAM_ENEMY);
+    enemyAi.plan(mapSet, units, TEAM_ENEMY, terrainTypes, decorationTypes, *workerPool, enemyOrders);
+    std::vector<int> before(enemyOrders.size());
+    for (size_t k = 0; k < enemyOrders.size(); k++) before[k] = units.tile[units.slot(enemyOrders[k].unit)];
+    auto start = std::chrono::steady_clock::now();
+    int attacks = enemyAi.execute(mapSet, units, enemyOrders, terrainTypes, decorationTypes, dice.combat());
+    double executeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    for (size_t k = 0; k < enemyOrders.size(); k++) {
+        int slot = units.slot(enemyOrders[k].unit);
+        if (slot != NO_ENTITY && units.tile[slot] != before[k]) animations.play(units, slot, animations.moveClip(units.unitClass[slot]));
+    }
+    units.resetMovePoints(TEAM_PLAYER);
+    LOG_INFO("Enemy turn: %d units planned in %.2f ms, carried out in %.2f ms, %d attacks", static_cast<int>(enemyOrders.size()),
+             enemyAi.lastPlanMilliseconds(), executeMs, attacks);
+}
+
+bool attRes() {
+    int p = units.slot(playerOne);
+    int t = units.slot(shotTarget);
+    if (p == NO_ENTITY || t == NO_ENTITY) {
+        // nobody picked, just a roll against the number on screen: it's the chance to hit, like combat.h's.
+        // (the original test had it backwards and scored a miss when the roll came in under it)
+        return dice.combat().percent(shotChance);
+    }
+    TerrainSight sight(mapSet, terrainTypes, decorationTypes);
+    AttackResult result = attack(mapSet, units, p, t, sight, dice.combat());
+    LOG_DEBUG("attack at %d%%: %s for %d", result.chance, result.hit ? "hit" : "miss", result.damage);
+    units.processDeaths(mapSet);
+    return result.hit;
+}
+
+SaveSession currentSession() {
+    SaveSession session;
+    session.turn = turn;
+    session.shotState = shotState;
+    session.shotChance = shotChance;
+    session.mapMode = mapMode ? 1 : 0;
+    session.playerOne = playerOne;
+    session.shotTarget = shotTarget;
+    session.cameraX = camera.x;
+    session.cameraY = camera.y;
+    session.dice = dice.save();
+    return session;
+}
+
+// Puts the game back the way the snapshot has it. Selection, views and the AI's orders start over.
+void restoreGame(const GameSnapshot& snapshot) {
+    mapSet = restoreMap(snapshot.map);
+    restoreUnits(snapshot.units, units, mapSet.size());
+    const SaveSession& session = snapshot.session;
+    turn = session.turn;
+    shotState = static_cast<shotStates>(session.shotState);
+    shotChance = session.shotChance;
+    mapMode = session.mapMode != 0;
+    playerOne = session.playerOne;
+    shotTarget = session.shotTarget;
+    camera.x = session.cameraX;
+    camera.y = session.cameraY;
+    previousCamera = camera;
+    dice.restore(session.dice);
+
+    picking = Picking();
+    picking.marks.resize(mapSet.size());
+    visibleMarksFor.clear();
+    visibleMarksValid = false;
+    picking.resolve(mapSet, camera.screenLayout(mapLayout), cursorX, cursorY, tileCenter);
+    visibility.clear();
+    enemyOrders.clear();
+    objectives.clear();
+    mapStreamer = MapStreamer();
+    mapStreamer.update(mapSet, camera.screenLayout(mapLayout), Camera{0, 0, camera.w, camera.h}, 100, 100);
+    fightBackground.invalidate();
+    fightText.invalidate();
+    for (int i = 0; i < units.count(); i++) {
+        animations.play(units, i, animations.idleClip(units.unitClass[i]));
+    }
+}
+
+// Start of a player turn: snapshot on top of the last one, then autosave it off the main thread.
+void snapshotTurn() {
+    auto start = std::chrono::steady_clock::now();
+    SnapshotStats stats;
+    undoHistory.push(takeSnapshot(mapSet, units, currentSession(), undoHistory.latest(), &stats));
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    LOG_INFO("Turn %u snapshot in %.2f ms: %d of %d chunks and %d unit pages new", turn, ms, stats.newChunks, mapSet.chunkCount(),
+             stats.newPages);
+    if (autosavePath != nullptr) saveWriter.save(autosavePath, *undoHistory.latest(), terrainNames, decorationNames);
+}
+
+// 'g' switches between the map and the fight screen, aiming at the enemy on the selected tile if there is one
+void toggleFightScreen() {
+    mapMode = !mapMode;
+    shotState = PRESHOT;
+    shotTarget = EntityHandle();
+    shotChance = dice.combat().range(0, 99);
+    int p = units.slot(playerOne);
+    int target = picking.marks.tilesWith(MARK_SELECTED).empty() ? -1 : picking.marks.tilesWith(MARK_SELECTED).front();
+    int t = target >= 0 ? units.occupant(target) : NO_ENTITY;
+    if (p != NO_ENTITY && t != NO_ENTITY && units.team[t] != units.team[p]) {
+        TerrainSight sight(mapSet, terrainTypes, decorationTypes);
+        shotTarget = units.handle(t);
+        shotChance = attackChance(mapSet, units, p, t, sight);
+        LOG_DEBUG("target %d: line of sight %d, cover %d", target, lineOfSight(mapSet, units.tile[p], target, sight),
+                  coverAgainst(mapSet, units.tile[p], target, sight));
+    }
+}
+
+// Everything the player can do, live or from a replay.
+void applyCommand(const Command& command, SDL_Window* window) {
+    switch (command.type) {
+        case CMD_CURSOR:
+            cursorX = command.a;
+            cursorY = command.b;
+            LOG_TRACE("mouse x: %d mouse y: %d", cursorX, cursorY);
+            // the tile under the cursor only changes when the cursor or the camera does (see update for the camera)
+            picking.resolve(mapSet, camera.screenLayout(mapLayout), cursorX, cursorY, tileCenter);
+            break;
+        case CMD_CLICK:
+            //HandleMouseClick();
+            if (mapMode && picking.hovered >= 0) picking.toggleSelected(picking.hovered);
+            break;
+        case CMD_PAN:
+            panX = command.a;
+            panY = command.b;
+            break;
+        case CMD_TOGGLE_FIGHT:
+            toggleFightScreen();
+            break;
+        case CMD_CONFIRM_SHOT:
+            shotState = attRes() ? HIT : MISS;
+            break;
+        case CMD_END_TURN:
+            if (mapMode) {
+                runEnemyTurn();
+                turn++;
+                snapshotTurn();
+            }
+            break;
+        case CMD_TOGGLE_FULLSCREEN:
+            fullscreen = !fullscreen;
+            SDL_SetWindowFullscreen(window, fullscreen ? SDL_WINDOW_FULLSCREEN : 0);
+            break;
+        case CMD_TOGGLE_PROFILER:
+            showProfiler = !showProfiler;
+            break;
+        case CMD_WRITE_TRACE:
+#if PROFILE_ENABLED
+            if (profiler().writeChromeTrace(tracePath)) LOG_INFO("Wrote %d frames to %s", profiler().frameCount(), tracePath);
+            else LOG_ERROR("Can't write %s", tracePath);
+#else
+            LOG_WARN("Built without PROFILE_ENABLED, no trace to write");
+#endif
+            break;
+        case CMD_QUIT:
+            isRunning = false;
+            break;
+        case CMD_UNDO:
+            if (const GameSnapshot* snapshot = undoHistory.undo()) {
+                restoreGame(*snapshot);
+                LOG_INFO("Back to turn %u", turn);
+            }
+            break;
+        case CMD_QUICKSAVE:
+            // the current state, not the turn's start; it doesn't go on the undo history
+            // a replay keeps it in memory for its F9, the file is the user's
+            quicksave.reset(new GameSnapshot(takeSnapshot(mapSet, units, currentSession(), undoHistory.latest())));
+            if (!replaying) saveWriter.save(quicksavePath, *quicksave, terrainNames, decorationNames);
+            break;
+        case CMD_QUICKLOAD: {
+            // the file only when this session hasn't quicksaved, a quicksave from this session may still be being written.
+            // A recording can't count on what's on disk when it's played back, there it's this session's or nothing
+            GameSnapshot loaded;
+            if (quicksave) loaded = *quicksave;
+            if (!quicksave && (recordPath != nullptr || replaying)) {
+                LOG_INFO("Nothing quicksaved in this session, F9 only loads those while recording");
+            } else if (quicksave || loadSave(quicksavePath, terrainNames, decorationNames, loaded)) {
+                restoreGame(loaded);
+                undoHistory.clear();
+                undoHistory.push(std::move(loaded));
+            }
+            break;
+        }
+        case CMD_TICKS:
+        case CMD_TYPE_COUNT:
+            break;
+    }
+}
+
+// This frame's commands from SDL. Keys act when they go down (key repeat doesn't count),
+// the cursor and the held arrow keys are only sent when they change.
+void pollCommands(std::vector<Command>& out) {
+    auto push = [&](CommandType type, int a = 0, int b = 0) { out.push_back(Command{frameNumber, type, a, b}); };
+    int newMouseX, newMouseY;
+    SDL_GetMouseState(&newMouseX, &newMouseY);
+    if (cursorX != newMouseX || cursorY != newMouseY) push(CMD_CURSOR, newMouseX, newMouseY);
+
+    while (SDL_PollEvent(&event)) {
+        if (event.type == SDL_QUIT) {
+            push(CMD_QUIT);
+        } else if (event.type == SDL_MOUSEBUTTONDOWN && event.button.button == SDL_BUTTON_LEFT) {
+            push(CMD_CLICK);
+        } else if (event.type == SDL_RENDER_TARGETS_RESET || event.type == SDL_RENDER_DEVICE_RESET) {
+            // the composed UI layers are gone with the render targets
+            fightBackground.invalidate();
+            fightText.invalidate();
+            backgrounds.invalidate();
+        } else if (event.type == SDL_KEYDOWN && !event.key.repeat) {
+            switch (event.key.keysym.sym) {
+                case SDLK_e: push(CMD_END_TURN); break;
+                case SDLK_g: push(CMD_TOGGLE_FIGHT); break;
+                case SDLK_RETURN:
+                case SDLK_KP_ENTER: push(CMD_CONFIRM_SHOT); break;
+                case SDLK_F3: push(CMD_TOGGLE_PROFILER); break;
+                case SDLK_F4: push(CMD_WRITE_TRACE); break;
+                case SDLK_ESCAPE: push(CMD_TOGGLE_FULLSCREEN); break;
+                case SDLK_u: push(CMD_UNDO); break;
+                case SDLK_F5: push(CMD_QUICKSAVE); break;
+                case SDLK_F9: push(CMD_QUICKLOAD); break;
+                default: break;
+            }
+        }
+    }
+
+    const Uint8* keys = SDL_GetKeyboardState(nullptr);
+    int dx = keys[SDL_SCANCODE_RIGHT] - keys[SDL_SCANCODE_LEFT];
+    int dy = keys[SDL_SCANCODE_DOWN] - keys[SDL_SCANCODE_UP];
+    if (dx != panX || dy != panY) push(CMD_PAN, dx, dy);
+}
+
+// Gathers this frame's commands, live or from the replay, records them and acts on them.
+// ticks is how many simulation ticks the frame is about to run; a replay replaces it with the recorded count.
+void handleInput(SDL_Window* window, int& ticks) {
+    frameCommands.clear();
+    if (replaying) {
+        // the window still needs its events pumped, closing it ends the replay early
+        while (SDL_PollEvent(&event)) {
+            if (event.type == SDL_QUIT) isRunning = false;
+            else if (event.type == SDL_RENDER_TARGETS_RESET || event.type == SDL_RENDER_DEVICE_RESET) {
+                fightBackground.invalidate();
+                fightText.invalidate();
+                backgrounds.invalidate();
+            }
+        }
+        player.take(frameNumber, frameCommands);
+    } else {
+        if (ticks != streamTicks) frameCommands.push_back(Command{frameNumber, CMD_TICKS, ticks, 0});
+        pollCommands(frameCommands);
+    }
+
+    for (const Command& command : frameCommands) {
+        if (recordPath != nullptr) recorder.add(command);
+        if (command.type == CMD_TICKS) streamTicks = command.a;
+        else applyCommand(command, window);
+    }
+    if (replaying) {
+        ticks = std::max(streamTicks, 0);
+        if (player.finished() && frameNumber >= player.lastFrame()) isRunning = false;
+    }
+}
+
+// One fixed simulation tick. Anything that moves over time goes here and not in render,
+// so it behaves the same at any frame rate.
+void update(double dt) {
+    previousCamera = camera;
+    backgrounds.update(dt);
+
+    // pan the map camera while the arrow keys are held
+    if (mapMode) {
+        camera.x += panX * cameraPanSpeed * dt;
+        camera.y += panY * cameraPanSpeed * dt;
+    }
+
+    if (camera.x != previousCamera.x || camera.y != previousCamera.y) {
+        picking.resolve(mapSet, camera.screenLayout(mapLayout), cursorX, cursorY, tileCenter);
+        mapStreamer.update(mapSet, camera.screenLayout(mapLayout), Camera{0, 0, camera.w, camera.h}, 100, 100);
+    }
+
+    animations.advance(units, static_cast<float>(dt));
+
+    PROFILE_ZONE("visibility");
+    // only units that moved (or had something change in view) get their field of view redone
+    int recomputed = visibility.refresh(mapSet, units, TerrainSight(mapSet, terrainTypes, decorationTypes));
+    playerUnits.clear();
+    for (int i = 0; i < units.count(); i++) {
+        if (units.team[i] == TEAM_PLAYER) playerUnits.push_back(units.handle(i));
+    }
+    if (recomputed > 0 || playerUnits != visibleMarksFor || !visibleMarksValid) {
+        picking.marks.clear(MARK_VISIBLE);
+        for (EntityHandle h : playerUnits) {
+            for (int tile : visibility.visibleTiles(h)) picking.marks.set(tile, MARK_VISIBLE);
+        }
+        visibleMarksFor.swap(playerUnits);
+        visibleMarksValid = true;
+    }
+}
+
+// a kind's tint on top of a shade
+SDL_Color tinted(SDL_Color shade, const TileKind& kind) {
+    return SDL_Color{static_cast<Uint8>(shade.r * kind.tint[0] / 255), static_cast<Uint8>(shade.g * kind.tint[1] / 255),
+                     static_cast<Uint8>(shade.b * kind.tint[2] / 255), shade.a};
+}
+
+void RenderTileMap(SDL_Renderer* renderer, int tileWidth, const HexMap& tileMap, const Camera& view) {
+    PROFILE_ZONE("tiles");
+    Layout flatLayout = view.screenLayout(mapLayout);
+    const SDL_Color white = {255, 255, 255, 255};
+    const SDL_Color unseen = {110, 110, 130, 255}; // tiles none of the player's units can see are drawn darker
+
+    // only the tiles that overlap the screen, the range comes straight from the layout and
+    // all their pixel positions are converted in one batch.
+    // nothing is drawn here, the tiles are sorted into layers and each layer is one draw call below
+    collectVisibleHexes(tileMap, flatLayout, Camera{0, 0, view.w, view.h}, tileWidth, tileWidth, visibleHexes);
+    for (size_t v = 0; v < visibleHexes.size(); v++) {
+        const Tile& data = tileMap[visibleHexes.index[v]];
+        Hex tile(visibleHexes.q[v], visibleHexes.r[v]);
+        int x = visibleHexes.x[v]; //converting these doubles to ints
+        int y = visibleHexes.y[v];
+        SDL_FRect destRect = {static_cast<float>(x), static_cast<float>(y), static_cast<float>(tileWidth), static_cast<float>(tileWidth)};
+        SDL_Rect textRect = {x+10, y+35, 80, 30};
+
+        // kinds without a sprite (like "none") are skipped
+        SDL_Color shade = picking.marks.has(visibleHexes.index[v], MARK_VISIBLE) ? white : unseen;
+        int terrainSprite = terrainTypes.sprite(data.terrain);
+        if (terrainSprite >= 0) {
+            tileLayers.ground.add(tileAtlas.region(terrainSprite), destRect, tinted(shade, terrainTypes.kind(data.terrain)));
+        }
+
+        if ((picking.marks.get(visibleHexes.index[v]) & (MARK_HOVER | MARK_SELECTED)) != 0 && highlightSprite >= 0) {
+            tileLayers.highlight.add(tileAtlas.region(highlightSprite), destRect);
+        }
+
+        int decorationSprite = decorationTypes.sprite(data.decoration);
+        if (decorationSprite >= 0) {
+            tileLayers.decoration.add(tileAtlas.region(decorationSprite), destRect, tinted(shade, decorationTypes.kind(data.decoration)));
+        }
+
+        char tileCoords[48];
+        snprintf(tileCoords, sizeof(tileCoords), "%d,%d,%d", tile.q, tile.r, tile.s);
+        batchText(tileLayers.labels, boldGlyphs, tileCoords, textRect, white);
+    }
+
+    tileLayers.ground.draw(renderer, tileAtlas.texture());
+    tileLayers.highlight.draw(renderer, tileAtlas.texture());
+    tileLayers.decoration.draw(renderer, tileAtlas.texture());
+    tileLayers.labels.draw(renderer, boldGlyphs.texture);
+}
+
+void RenderUnits(SDL_Renderer* renderer, const Camera& view) {
+    PROFILE_ZONE("units");
+    Layout screen = view.screenLayout(mapLayout);
+    const float unitHeight = 94; // frames differ in size a bit, they're all scaled to the same height
+    unitSprites.clear();
+    for (int i = 0; i < units.count(); i++) {
+        int region = animations.frameAt(units.animClip[i], units.animTime[i]);
+        if (region < 0) continue;
+        const SDL_Rect& frame = unitAtlas.region(region).rect;
+        float w = unitHeight * frame.w / frame.h;
+        Point p = hex_to_pixel(screen, mapSet.hexAt(units.tile[i]));
+        // feet at the bottom of the tile sprite's middle, same spot the player used to be drawn at
+        SDL_FRect dest = {static_cast<float>(p.x) + 50 - w / 2, static_cast<float>(p.y) + 3, w, unitHeight};
+        if (dest.x + dest.w < 0 || dest.y + dest.h < 0 || dest.x > view.w || dest.y > view.h) continue;
+        unitSprites.push_back(UnitSprite{dest.y + dest.h, region, dest});
+    }
+    // back to front, so units lower on the screen stand in front of the ones behind them
+    std::sort(unitSprites.begin(), unitSprites.end(), [](const UnitSprite& a, const UnitSprite& b) { return a.depth < b.depth; });
+    for (const UnitSprite& sprite : unitSprites) {
+        tileLayers.unitSprites.add(unitAtlas.region(sprite.region), sprite.dest);
+    }
+    tileLayers.unitSprites.draw(renderer, unitAtlas.texture());
+}
+
+SDL_Rect createRect(int row, int col, int textureWidth, int textureHeight) {
+    SDL_Rect rect;
+    rect.x = col * textureWidth;
+    rect.y = row * textureHeight;
+    rect.w = textureWidth;
+    rect.h = textureHeight;
+    return rect;
+}
+
+void composeFightBackground() {
+    SDL_SetRenderDrawColor(renderer, 0, 255, 0, 255);
+    renderClear(renderer);
+
+    SDL_Rect attacker = { 20, 280, 380, 300};
+    renderCopy(renderer, assets.texture(fightAttacker), nullptr, &attacker);
+
+    SDL_Rect target = { 450, 50, 350, 250 };
+    renderCopy(renderer, assets.texture(fightTarget), nullptr, &target);
+
+    switch (shotState) {
+        case PRESHOT: {
+            for (int i = 0; i < 6; i++) {
+                SDL_Rect button = { 400 + 50 * i, 500, 50, 50 };
+                renderCopy(renderer, assets.texture(fightButtons[i]), nullptr, &button);
+            }
+            break;
+        } case HIT:
+          case MISS: {
+            std::string hitMsg = shotState == HIT ? "*** SUCCESS :) ****" : "*** MISS :( ****";
+            SDL_Color color = shotState == HIT ? SDL_Color{0, 0, 255, 255} : SDL_Color{255, 0, 0, 255};
+
+            SDL_Texture* textTexture = textCache.get(renderer, fontBold, hitMsg).texture;
+            SDL_SetTextureColorMod(textTexture, color.r, color.g, color.b);
+            int textureWidth = 200;
+            int textureHeight = 50;
+            // Loop to render the grid of textures
+            for (int row = 0; row < numRows; ++row) {
+                for (int col = 0; col < numCols; ++col) {
+                    // Create SDL_Rect for the current position in the grid
+                    SDL_Rect currentRect = createRect(row, col, textureWidth, textureHeight);
+
+                    // Render the texture at the current position
+                    renderCopy(renderer, textTexture, NULL, &currentRect);
+                }
+            }
+            break;
+        }
+    }
+}
+
+// in white when it's composed, the color comes from tinting the layer then
+void composeFightText(SDL_Color color = {255, 255, 255, 255}, bool composing = true) {
+    std::string hitMsg = "*** Chance to hit: CODE_PLACEHOLDE% ****";
+    size_t found = hitMsg.find("CODE_PLACEHOLDE");
+    if (found != std::string::npos) {
+        hitMsg.replace(found, 15, std::to_string(shotChance));
+    }
+
+    SDL_Texture* textTexture = textCache.get(renderer, fontBold, hitMsg).texture;
+    if (textTexture == nullptr) return;
+    SDL_SetTextureColorMod(textTexture, color.r, color.g, color.b);
+    // the copies don't overlap, so copy the pixels as they are. blending them into the transparent
+    // layer would darken the antialiased edges, and then again when the layer is blended onto the screen
+    if (composing) SDL_SetTextureBlendMode(textTexture, SDL_BLENDMODE_NONE);
+    const SDL_Rect rects[7] = {
+        { 50, 0, 300, 50 }, { 50, 50, 300, 50 }, { 50, 100, 300, 50 },
+        { 200, 150, 300, 50 }, { 200, 200, 300, 50 }, { 200, 250, 300, 50 }, { 200, 300, 300, 50 },
+    };
+    for (const SDL_Rect& rect : rects) {
+        renderCopy(renderer, textTexture, NULL, &rect);
+    }
+    SDL_SetTextureBlendMode(textTexture, SDL_BLENDMODE_BLEND);
+}
+
+void renderFightUI() {
+    PROFILE_ZONE("fight ui");
+    int w, h;
+    SDL_GetRendererOutputSize(renderer, &w, &h);
+
+    // only what the change touches is composed again
+    if (shotState != composedShotState) {
+        fightBackground.invalidate();
+        fightText.invalidate();
+        composedShotState = shotState;
+    }
+    if (shotChance != composedShotChance) {
+        fightText.invalidate();
+        composedShotChance = shotChance;
+    }
+    // without render targets the layers are drawn straight to the screen every frame, like before they were cached
+    if (fightBackground.begin(renderer, w, h)) {
+        composeFightBackground();
+        fightBackground.end(renderer);
+    }
+    if (fightBackground.ready()) fightBackground.draw(renderer);
+    else composeFightBackground();
+
+    if (shotState == PRESHOT) {
+        if (fightText.begin(renderer, w, h)) {
+            composeFightText();
+            fightText.end(renderer);
+        }
+        SDL_Color flash = {static_cast<Uint8>(dice.cosmetic().range(0, 255)), 0, static_cast<Uint8>(dice.cosmetic().range(0, 255)), 255};
+        if (fightText.ready()) fightText.draw(renderer, flash);
+        else composeFightText(flash, false);
+    }
+}
+
+#if PROFILE_ENABLED
+// Frame time, counters and the last frame's zones in the top left corner. Drawn from the glyph atlas
+// so it doesn't create textures itself, but its own glyph batch does show up in the next frame's counts.
+SpriteBatch profilerText;
+void renderProfilerOverlay() {
+    const Profiler& prof = profiler();
+    if (prof.frameCount() == 0) return;
+    PROFILE_ZONE("profiler overlay");
+    const ProfileFrame& last = prof.frame(0);
+    double total = 0.0;
+    double worst = 0.0;
+    for (int i = 0; i < prof.frameCount(); i++) {
+        total += prof.frame(i).milliseconds();
+        worst = std::max(worst, prof.frame(i).milliseconds());
+    }
+
+    const int lineHeight = 16;
+    int lines = 2 + last.zoneCount;
+    SDL_Rect background = {0, 0, 300, lines * lineHeight + 8};
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 170);
+    renderFillRect(renderer, &background);
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+
+    const SDL_Color white = {255, 255, 255, 255};
+    const SDL_Color grey = {190, 190, 190, 255};
+    char line[96];
+    int y = 4;
+    auto add = [&](const char* text, int indent, SDL_Color color) {
+        int w = measureText(boldGlyphs, text) * lineHeight / std::max(1, boldGlyphs.lineHeight);
+        batchText(profilerText, boldGlyphs, text, SDL_Rect{4 + indent * 10, y, w, lineHeight}, color);
+        y += lineHeight;
+    };
+    snprintf(line, sizeof(line), "frame %.2f ms  avg %.2f  max %.2f", last.milliseconds(), total / prof.frameCount(), worst);
+    add(line, 0, white);
+    snprintf(line, sizeof(line), "draws %llu  textures %llu  allocs %llu",
+             static_cast<unsigned long long>(last.counters[PROFILE_DRAW_CALLS]),
+             static_cast<unsigned long long>(last.counters[PROFILE_TEXTURES_CREATED]),
+             static_cast<unsigned long long>(last.counters[PROFILE_ALLOCATIONS]));
+    add(line, 0, white);
+    for (int z = 0; z < last.zoneCount; z++) {
+        snprintf(line, sizeof(line), "%s %.3f ms", last.zones[z].name, last.zoneMilliseconds(z));
+        add(line, last.zones[z].depth, grey);
+    }
+    profilerText.draw(renderer, boldGlyphs.texture);
+}
+#endif
+
+// alpha is how far we are between the last two simulation ticks (0..1)
+void render(double alpha) {
+    PROFILE_ZONE("render");
+    if (mapMode && tileAtlas.texture() != nullptr) {
+        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+        renderClear(renderer);
+
+        SDL_GetRendererOutputSize(renderer, &camera.w, &camera.h);
+        Camera view = camera;
+        view.x = previousCamera.x + (camera.x - previousCamera.x) * alpha;
+        view.y = previousCamera.y + (camera.y - previousCamera.y) * alpha;
+        backgrounds.draw(renderer, view.x, view.y);
+        {
+            ScopedTiming timing(tileTimings);
+            RenderTileMap(renderer, 100, mapSet, view);
+        }
+        RenderUnits(renderer, view);
+    } else {
+        ScopedTiming timing(fightTimings);
+        renderFightUI();
+    }
+
+#if PROFILE_ENABLED
+    if (showProfiler) renderProfilerOverlay();
+#endif
+
+    PROFILE_ZONE("present");
+    SDL_RenderPresent(renderer);
+}
+
+// progress bar while the assets load
+void renderLoadingScreen() {
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+    renderClear(renderer);
+    SDL_Rect outline = {200, 290, 400, 20};
+    SDL_Rect bar = {200, 290, static_cast<int>(400 * assets.progress()), 20};
+    SDL_SetRenderDrawColor(renderer, 60, 60, 60, 255);
+    renderFillRect(renderer, &outline);
+    SDL_SetRenderDrawColor(renderer, 0, 255, 0, 255);
+    renderFillRect(renderer, &bar);
+    char text[64];
+    snprintf(text, sizeof(text), "Loading %d/%d", assets.loaded(), assets.total());
+    drawText(renderer, boldGlyphs, text, SDL_Rect{200, 250, 400, 30}, SDL_Color{255, 255, 255, 255});
+    SDL_RenderPresent(renderer);
+}
+
+HexMap initMapSet(int winWidth, int winHeight, int tileDem) {
+    //numRows = winHeight / tileDem;
+    //numCols = (winWidth / tileDem);
+    numCols = 10;
+    numRows = 5;
+    LOG_INFO("Number of rows: %d", numRows);
+    LOG_INFO("Number of columns: %d", numCols);
+
+    // biomes, decorations and objectives come from noise, chunk by chunk on every core.
+    // the seed comes off the mapgen stream so --seed repeats the map too
+    MapGenSettings settings;
+    // two statements: the order operands are evaluated in isn't specified, and the halves have to come out the same way every run
+    uint64_t high = dice.mapgen().next();
+    uint64_t low = dice.mapgen().next();
+    settings.seed = (high << 32) | low;
+    MapGenerator generator(biomes, settings);
+    HexMap map(generateWidth, generateHeight);
+    auto start = std::chrono::steady_clock::now();
+    objectives = generator.generate(map, workerPool);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    LOG_INFO("Generated a %dx%d map in %.1f ms, %d objectives", map.width(), map.height(), ms, static_cast<int>(objectives.size()));
+    return map;
+}
+
+// The map from --map (opened already) or a generated one, with its units.
+void startNewGame(const char* mapPath) {
+    //the mapSet var is initialized here so it can be used to draw the map
+    if (mapPath != nullptr) {
+        mapSet = mapFile.map();
+        mapStreamer.update(mapSet, camera.screenLayout(mapLayout), Camera{0, 0, camera.w, camera.h}, 100, 100);
+    } else {
+        mapSet = initMapSet(800, 600, 100);
+    }
+    picking.marks.resize(mapSet.size());
+    visibleMarksFor.clear();
+    visibleMarksValid = false;
+    units.resizeMap(mapSet.size());
+    if (mapPath != nullptr) {
+        // the first player spawn is the unit HandleMouseClick moves
+        for (const MapSpawn& spawn : mapFile.spawns) {
+            EntityHandle h = units.spawn(static_cast<Team>(spawn.team), static_cast<UnitClass>(spawn.unitClass),
+                                         mapSet.index(Hex(spawn.q, spawn.r)));
+            if (spawn.team == TEAM_PLAYER && !units.alive(playerOne)) playerOne = h;
+        }
+    } else {
+        playerOne = units.spawn(TEAM_PLAYER, CLASS_ASSAULT, mapSet.index(Hex(0, 0)));
+        units.spawn(TEAM_ENEMY, CLASS_HEAVY, mapSet.index(Hex(7, -2)));
+    }
+    for (int i = 0; i < units.count(); i++) {
+        animations.play(units, i, animations.idleClip(units.unitClass[i]));
+    }
+}
+
+bool startGame(const GameOptions& options) {
+    gameOptions = options;
+    const char* mapPath = options.mapPath;
+    const char* replayPath = options.replayPath;
+    const char* loadPath = options.loadPath;
+    // a replay has to start from what the recording did, and a save file isn't part of it
+    if (loadPath != nullptr && (options.recordPath != nullptr || replayPath != nullptr)) {
+        LOG_ERROR("--load can't be combined with --record or --replay");
+        return false;
+    }
+    bool offscreen = options.offscreen;
+    bool bossAi = options.bossAi;
+    uint64_t seed = options.seed;
+    vsync = options.vsync;
+    targetFps = options.targetFps;
+    tickRate = std::max(1, options.tickRate);
+    tracePath = options.tracePath;
+    autosavePath = options.autosavePath;
+    generateWidth = std::max(10, options.generateWidth);
+    generateHeight = std::max(5, options.generateHeight);
+    recordPath = options.recordPath;
+    aiPlayouts = 0;
+    headless = options.headless;
+
+    // a replay starts the game up the way the recording did, and runs as fast as it can
+    if (replayPath != nullptr) {
+        if (!player.load(replayPath)) {
+            return false;
+        }
+        const ReplayHeader& info = player.info();
+        seed = info.seed;
+        tickRate = info.tickRate;
+        generateWidth = info.generateWidth;
+        generateHeight = info.generateHeight;
+        bossAi = info.bossAi != 0;
+        aiPlayouts = info.aiPlayouts;
+        mapPath = info.mapPath.empty() ? nullptr : info.mapPath.c_str();
+        targetFps = 0;
+        vsync = false;
+        replaying = true;
+        recordPath = nullptr;
+        autosavePath = nullptr; // a replay doesn't touch the saves on disk, or spend its timed frames writing them
+        LOG_INFO("Replaying %s, %u frames", replayPath, player.lastFrame() + 1);
+    }
+    if (recordPath != nullptr) {
+        aiPlayouts = recordedAiPlayouts;
+        ReplayHeader info;
+        info.seed = seed;
+        info.tickRate = tickRate;
+        info.generateWidth = generateWidth;
+        info.generateHeight = generateHeight;
+        info.bossAi = bossAi ? 1 : 0;
+        info.aiPlayouts = aiPlayouts;
+        if (mapPath != nullptr) info.mapPath = mapPath;
+        recorder.begin(info);
+    }
+    dice.seed(seed);
+    AiSettings aiSettings;
+    aiSettings.seed = seed;
+    aiSettings.playoutsPerOption = aiPlayouts;
+    if (bossAi) aiSettings.mctsClasses = 1u << CLASS_HEAVY; // heavies are the closest thing to a boss so far
+    enemyAi = AiPlanner(aiSettings);
+    LOG_INFO("Random seed: %llu (pass --seed %llu to repeat this run)", static_cast<unsigned long long>(seed), static_cast<unsigned long long>(seed));
+
+    // no display needed: SDL's dummy video driver keeps the window in memory, and only the software
+    // renderer works with it
+    if (headless || offscreen) SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+
+    // Initialize SDL
+    if (SDL_Init(SDL_INIT_VIDEO) != 0) {
+        LOG_ERROR("SDL could not initialize! SDL_Error: %s", SDL_GetError());
+        return false;
+    }
+
+    // Create a window
+    window = SDL_CreateWindow("Based aspect ratio (4:3)", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, 800, 600, SDL_WINDOW_SHOWN);
+
+    if (!window) {
+        LOG_ERROR("Window could not be created! SDL_Error: %s", SDL_GetError());
+        return false;
+    }
+
+    if (TTF_Init() == -1) {
+        throw std::runtime_error("TrueType font support (TTF) failed to initialize");
+    }
+    fontReg = TTF_OpenFont("./ttf/Hack-Regular.ttf", 24);
+    fontBold = TTF_OpenFont("./ttf/Hack-Bold.ttf", 24);
+
+    // initialize the renderer variable (already declared globally)
+    Uint32 rendererFlags = headless || offscreen ? SDL_RENDERER_SOFTWARE : SDL_RENDERER_ACCELERATED | (vsync ? SDL_RENDERER_PRESENTVSYNC : 0);
+    renderer = SDL_CreateRenderer(window, -1, rendererFlags);
+    if (!renderer) {
+        LOG_ERROR("Renderer could not be created! SDL_Error: %s", SDL_GetError());
+        return false;
+    }
+
+    // rasterize the label glyphs once instead of every tile every frame
+    buildGlyphAtlas(renderer, fontBold, boldGlyphs);
+
+    // decode every image in the manifest on the pool while the render thread uploads what's ready
+    // and draws a progress bar
+    workers.reset(new ThreadPool());
+    workerPool = workers.get();
+    if (!assets.load("assets/manifest.txt", *workers)) {
+        return false;
+    }
+    while (!assets.pump(renderer, 4.0)) {
+        while (SDL_PollEvent(&event)) {
+            if (event.type == SDL_QUIT) isRunning = false;
+        }
+        renderLoadingScreen();
+        SDL_Delay(1);
+    }
+    if (assets.failures() > 0) {
+        LOG_ERROR("%d assets failed to load, check the paths in assets/manifest.txt", assets.failures());
+        return false;
+    }
+    fightAttacker = assets.handle("fight-attacker");
+    fightTarget = assets.handle("fight-target");
+    const char* buttonNames[6] = {"button-primary", "button-side", "button-sword", "button-lsd", "button-hack", "button-hack2"};
+    for (int i = 0; i < 6; i++) fightButtons[i] = assets.handle(buttonNames[i]);
+
+    // a map file brings its own kind ids, they have to be registered before anything else
+    if (mapPath != nullptr && (!mapFile.open(mapPath) || !mapFile.registerKinds(terrainTypes, decorationTypes))) {
+        return false;
+    }
+
+    // the map sprites get packed into one atlas texture, then the terrain/decoration names
+    // are interned with their atlas regions before any tile refers to them
+    int tileSprite = tileAtlas.add("tile", assets.takeSurface(assets.handle("tile")));
+    highlightSprite = tileAtlas.add("highlight", assets.takeSurface(assets.handle("highlight")));
+    terrainTypes.add("plain", tileSprite);
+    decorationTypes.add("birch", tileAtlas.add("birch", assets.takeSurface(assets.handle("birch"))));
+    decorationTypes.add("tree", tileAtlas.add("tree", assets.takeSurface(assets.handle("tree"))));
+    // move costs, sight and cover live in registerBiomes (thick trees cost an extra point to walk through).
+    // the biomes don't have art yet, they're the plain tile tinted
+    biomes = registerBiomes(terrainTypes, decorationTypes);
+    const struct { TileKindId kind; uint8_t r, g, b; } biomeTints[] = {
+        {biomes.tundra, 225, 235, 255},
+        {biomes.rainforest, 120, 200, 110},
+        {biomes.reef, 90, 170, 230},
+        {biomes.swamp, 140, 150, 100},
+    };
+    for (const auto& t : biomeTints) {
+        TileKind& kind = terrainTypes.kind(t.kind);
+        kind.sprite = tileSprite;
+        kind.tint[0] = t.r;
+        kind.tint[1] = t.g;
+        kind.tint[2] = t.b;
+    }
+    TileKind& objective = decorationTypes.kind(biomes.objective);
+    objective.sprite = highlightSprite;
+    objective.tint[0] = 255;
+    objective.tint[1] = 200;
+    objective.tint[2] = 60;
+    tileAtlas.build(renderer);
+    if (!animations.load("assets/animations.txt", assets, unitAtlas) || !unitAtlas.build(renderer)) {
+        return false;
+    }
+    if (!backgrounds.load("assets/parallax.txt", assets)) {
+        return false;
+    }
+    // a map file's location is its name (maps/clearing.map is "clearing"), generated maps get the default
+    std::string location = "default";
+    if (mapPath != nullptr) {
+        location = mapPath;
+        location = location.substr(location.find_last_of("/\\") + 1);
+        location = location.substr(0, location.find('.'));
+    }
+    backgrounds.select(location);
+
+    terrainNames = kindNames(terrainTypes);
+    decorationNames = kindNames(decorationTypes);
+
+    if (loadPath != nullptr) {
+        // a save brings its own map and units
+        GameSnapshot loaded;
+        if (!loadSave(loadPath, terrainNames, decorationNames, loaded)) {
+            return false;
+        }
+        restoreGame(loaded);
+        undoHistory.push(std::move(loaded));
+    } else {
+        startNewGame(mapPath);
+        snapshotTurn();
+    }
+    return true;
+}
+
+void runGame() {
+    // input once per frame, the simulation in fixed ticks, then one interpolated render.
+    // the frame cap also keeps us from pinning a core when vsync isn't available
+    FrameClock clock(tickRate, targetFps);
+    if (replaying) {
+        frameTimings = &replayFrames;
+        tileTimings = &replayTiles;
+        fightTimings = &replayFight;
+    }
+    while (isRunning) {
+        PROFILE_FRAME();
+        int ticks = clock.beginFrame();
+        {
+            ScopedTiming timing(frameTimings);
+            {
+                PROFILE_ZONE("input");
+                handleInput(window, ticks);
+            }
+            {
+                PROFILE_ZONE("update");
+                for (int i = 0; i < ticks; i++) {
+                    update(clock.tickSeconds());
+                }
+            }
+            // a replay draws the last tick as it is, the recording's in-between positions weren't kept
+            if (!headless) render(replaying ? 1.0 : clock.alpha());
+        }
+        frameNumber++;
+        PROFILE_ZONE("frame cap");
+        clock.endFrame();
+    }
+}
+
+int stopGame() {
+    // the quit that ended the loop is the recording's last command
+    int exitCode = 0;
+    if (recordPath != nullptr && !recorder.save(recordPath)) exitCode = 1;
+    if (replaying) {
+        replayFrames.logSummary();
+        if (replayTiles.count() > 0) replayTiles.logSummary();
+        if (replayFight.count() > 0) replayFight.logSummary();
+        if (gameOptions.reportPath != nullptr && !writeTimingReport(gameOptions.reportPath, {&replayFrames, &replayTiles, &replayFight})) exitCode = 1;
+    }
+
+    // Cleanup and quit
+    saveWriter.finish();
+    quicksave.reset();
+    if (workerPool != nullptr) workerPool->wait(); // images still decoding after an early quit
+    assets.destroy();
+    textCache.clear();
+    tileAtlas.destroy();
+    unitAtlas.destroy();
+    fightBackground.destroy();
+    fightText.destroy();
+    backgrounds.destroy();
+    destroyGlyphAtlas(boldGlyphs);
+    workerPool = nullptr;
+    workers.reset();
+    SDL_DestroyRenderer(renderer);
+    SDL_DestroyWindow(window);
+    TTF_CloseFont(fontReg);
+    TTF_CloseFont(fontBold);
+    TTF_Quit();
+    SDL_Quit();
+    logger().stop();
+
+    return exitCode;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <SDL.h>
+#include <cstdint>
+#include "hexmap.h"
+#include "camera.h"
+
+// The game as a library (game.cpp). main.cpp turns the command line into GameOptions and runs it,
+// bench/game_bench.cpp drives the same code offscreen.
+
+struct GameOptions {
+    const char* mapPath = nullptr;    // --map, a generated map if not set
+    const char* loadPath = nullptr;   // --load
+    const char* recordPath = nullptr; // --record
+    const char* replayPath = nullptr; // --replay, overrides the seed, map and tick rate with the recording's
+    const char* reportPath = nullptr; // --report
+    const char* tracePath = "profile-trace.json"; // --trace
+    const char* autosavePath = "autosave.sav";     // --autosave, nullptr (--no-autosave) to not autosave
+    uint64_t seed = 0;
+    int generateWidth = 10;  // --generate W H
+    int generateHeight = 5;
+    int tickRate = 60;       // --tick-rate
+    int targetFps = 60;      // --fps, 0 = uncapped
+    bool vsync = true;       // --no-vsync
+    bool bossAi = false;     // --boss-ai
+    bool headless = false;   // --headless, no rendering at all
+    bool offscreen = false;  // --offscreen, render into the dummy video driver's memory
+};
+
+// SDL, the window, every asset and the first map (or the save). Logs why and returns false if any of it fails.
+bool startGame(const GameOptions& options);
+// Frames until the player quits or the replay runs out.
+void runGame();
+// Writes the recording and the replay report, frees everything. Returns the process's exit code.
+int stopGame();
+
+// What the benchmarks drive directly, once startGame has run.
+extern SDL_Renderer* renderer;
+extern HexMap mapSet;
+extern Camera camera;
+extern bool mapMode;
+extern int generateWidth;
+extern int generateHeight;
+void render(double alpha);
+HexMap initMapSet(int winWidth, int winHeight, int tileDem);
@@ -0,0 +1,234 @@
+#pragma once
+
+#include <boost/functional/hash.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+
+// Hex grid primitives, mostly straight from redblobgames.
+// Everything in here is plain math with no SDL so the map/pathfinding code can use it too.
+
+// https://www.redblobgames.com/grids/hexagons/implementation.html#hex
+// the int w parameter is used to distinguish between positions and vectors. Not useful yet but worth keeping around
+template <typename Number, int w>
+struct _Hex {
+    union {
+        const Number v[3];
+        struct { const Number q, r, s; };
+    };
+
+    bool operator==(const _Hex& other) const {
+        return q == other.q && r == other.r && s == other.s;
+    }
+    bool operator!=(const _Hex& other) const {
+        return !(*this == other);
+    }
+    _Hex(Number q_, Number r_) : v{q_, r_, -q_ - r_} {}
+    _Hex(Number q_, Number r_, Number s_) : v{q_, r_, s_} {}
+};
+
+using Hex = _Hex<int, 1>;
+using FracHex = _Hex<double, 1>;
+
+struct HexHash {
+    std::size_t operator()(const Hex& hex) const {
+        std::size_t seed = 0;
+        // Combine the hashes of q, r, and s using a hash combining function
+        boost::hash_combine(seed, hex.q);
+        boost::hash_combine(seed, hex.r);
+        boost::hash_combine(seed, hex.s);
+        return seed;
+    }
+};
+
+// https://www.redblobgames.com/grids/hexagons/implementation.html#hex-arithmetic
+inline Hex hex_add(Hex a, Hex b) {
+    return Hex(a.q + b.q, a.r + b.r, a.s + b.s);
+}
+
+inline Hex hex_subtract(Hex a, Hex b) {
+    return Hex(a.q - b.q, a.r - b.r, a.s - b.s);
+}
+
+// https://www.redblobgames.com/grids/hexagons/implementation.html#hex-distance
+inline int hex_length(Hex hex) {
+    return int((abs(hex.q) + abs(hex.r) + abs(hex.s)) / 2);
+}
+
+inline int hex_distance(Hex a, Hex b) {
+    return hex_length(hex_subtract(a, b));
+}
+
+// https://www.redblobgames.com/grids/hexagons/implementation.html#hex-neighbors
+// kept as plain ints so the table is a constant and not six constructed Hexes
+const int HEX_DIRECTION_Q[6] = {1, 1, 0, -1, -1, 0};
+const int HEX_DIRECTION_R[6] = {0, -1, -1, 0, 1, 1};
+
+inline Hex hex_direction(int direction) {
+    return Hex(HEX_DIRECTION_Q[direction], HEX_DIRECTION_R[direction]);
+}
+
+inline Hex hex_neighbor(Hex hex, int direction) {
+    return Hex(hex.q + HEX_DIRECTION_Q[direction], hex.r + HEX_DIRECTION_R[direction]);
+}
+
+// https://www.redblobgames.com/grids/hexagons/implementation.html#layout
+// everything here is constexpr so the layouts (and their precomputed coefficients) are compile time constants
+constexpr double SQRT3 = 1.7320508075688772935;
+
+struct Orientation {
+    const double f0, f1, f2, f3;
+    const double b0, b1, b2, b3;
+    const double start_angle; // in multiples of 60°
+    constexpr Orientation(double f0_, double f1_, double f2_, double f3_,
+                          double b0_, double b1_, double b2_, double b3_,
+                          double start_angle_)
+    : f0(f0_), f1(f1_), f2(f2_), f3(f3_),
+      b0(b0_), b1(b1_), b2(b2_), b3(b3_),
+      start_angle(start_angle_) {}
+};
+
+// layout_flat makes sense for our art rendering on top of tiles but might as well include both
+constexpr Orientation layout_pointy
+  = Orientation(SQRT3, SQRT3 / 2.0, 0.0, 3.0 / 2.0,
+                SQRT3 / 3.0, -1.0 / 3.0, 0.0, 2.0 / 3.0,
+                0.5);
+constexpr Orientation layout_flat
+  = Orientation(3.0 / 2.0, 0.0, SQRT3 / 2.0, SQRT3,
+                2.0 / 3.0, 0.0, -1.0 / 3.0, SQRT3 / 3.0,
+                0.0);
+
+struct Point {
+    const double x, y;
+    constexpr Point(double x_, double y_): x(x_), y(y_) {}
+};
+
+struct Layout {
+    const Orientation orientation;
+    const Point size;
+    const Point origin;
+    // the orientation matrices with size folded in, so a conversion is just a few multiply-adds
+    const double px0, px1, py0, py1; // hex -> pixel
+    const double hq0, hq1, hr0, hr1; // pixel -> fractional hex
+    constexpr Layout(Orientation orientation_, Point size_, Point origin_)
+    : orientation(orientation_), size(size_), origin(origin_),
+      px0(orientation_.f0 * size_.x), px1(orientation_.f1 * size_.x),
+      py0(orientation_.f2 * size_.y), py1(orientation_.f3 * size_.y),
+      hq0(orientation_.b0 / size_.x), hq1(orientation_.b1 / size_.y),
+      hr0(orientation_.b2 / size_.x), hr1(orientation_.b3 / size_.y) {}
+};
+
+// https://www.redblobgames.com/grids/hexagons/implementation.html#hex-to-pixel
+inline Point hex_to_pixel(const Layout& layout, Hex h) {
+    return Point(layout.px0 * h.q + layout.px1 * h.r + layout.origin.x,
+                 layout.py0 * h.q + layout.py1 * h.r + layout.origin.y);
+}
+
+// https://www.redblobgames.com/grids/hexagons/implementation.html#pixel-to-hex
+inline FracHex pixel_to_hex(const Layout& layout, Point p) {
+    double x = p.x - layout.origin.x;
+    double y = p.y - layout.origin.y;
+    double q = layout.hq0 * x + layout.hq1 * y;
+    double r = layout.hr0 * x + layout.hr1 * y;
+    return FracHex(q, r, -q - r);
+}
+
+// https://www.redblobgames.com/grids/hexagons/implementation.html#rounding
+inline Hex hex_round(FracHex h) {
+    int q = int(round(h.q));
+    int r = int(round(h.r));
+    int s = int(round(h.s));
+    double q_diff = std::abs(q - h.q);
+    double r_diff = std::abs(r - h.r);
+    double s_diff = std::abs(s - h.s);
+    if (q_diff > r_diff and q_diff > s_diff) {
+        q = -r - s;
+    } else if (r_diff > s_diff) {
+        r = -q - s;
+    } else {
+        s = -q - r;
+    }
+    return Hex(q, r, s);
+}
+
+// https://www.redblobgames.com/grids/hexagons/implementation.html#line-drawing
+inline FracHex hex_lerp(FracHex a, FracHex b, double t) {
+    return FracHex(a.q * (1.0 - t) + b.q * t, a.r * (1.0 - t) + b.r * t, a.s * (1.0 - t) + b.s * t);
+}
+
+// Calls visit(hex) for every hex on the line from a to b, both ends included.
+// The endpoints are nudged off the exact center so lines running along hex edges always
+// round to the same side instead of zigzagging. Nothing is allocated, pass a lambda.
+template <typename Visit>
+void hex_linedraw(Hex a, Hex b, Visit visit) {
+    int n = hex_distance(a, b);
+    FracHex a_nudge(a.q + 1e-6, a.r + 1e-6, a.s - 2e-6);
+    FracHex b_nudge(b.q + 1e-6, b.r + 1e-6, b.s - 2e-6);
+    double step = 1.0 / std::max(n, 1);
+    for (int i = 0; i <= n; i++) {
+        visit(hex_round(hex_lerp(a_nudge, b_nudge, step * i)));
+    }
+}
+
+// Batch versions of the above over structure-of-arrays inputs (q[], r[] instead of Hex[]).
+// The loops are branch free with no aliasing between inputs and outputs so the compiler can vectorize them;
+// use these whenever there's more than a handful of hexes to convert.
+inline void hex_to_pixel(const Layout& layout, const int* __restrict q, const int* __restrict r,
+                         double* __restrict x, double* __restrict y, size_t n) {
+    const double px0 = layout.px0, px1 = layout.px1, ox = layout.origin.x;
+    const double py0 = layout.py0, py1 = layout.py1, oy = layout.origin.y;
+    for (size_t i = 0; i < n; i++) {
+        x[i] = px0 * q[i] + px1 * r[i] + ox;
+        y[i] = py0 * q[i] + py1 * r[i] + oy;
+    }
+}
+
+// fractional results, feed them to the batch hex_round
+inline void pixel_to_hex(const Layout& layout, const double* __restrict x, const double* __restrict y,
+                         double* __restrict q, double* __restrict r, size_t n) {
+    const double hq0 = layout.hq0, hq1 = layout.hq1, ox = layout.origin.x;
+    const double hr0 = layout.hr0, hr1 = layout.hr1, oy = layout.origin.y;
+    for (size_t i = 0; i < n; i++) {
+        double px = x[i] - ox;
+        double py = y[i] - oy;
+        q[i] = hq0 * px + hq1 * py;
+        r[i] = hr0 * px + hr1 * py;
+    }
+}
+
+// std::round is a libm call on baseline x86-64 which keeps the loop from vectorizing,
+// adding +-0.5 and truncating rounds the same way (halves away from zero) with plain conversions
+inline int round_half_away(double v) {
+    return static_cast<int>(v + (v < 0 ? -0.5 : 0.5));
+}
+
+inline void hex_round(const double* __restrict fq, const double* __restrict fr,
+                      int* __restrict q, int* __restrict r, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        double fs = -fq[i] - fr[i];
+        int rq = round_half_away(fq[i]);
+        int rr = round_half_away(fr[i]);
+        int rs = round_half_away(fs);
+        double q_diff = std::abs(rq - fq[i]);
+        double r_diff = std::abs(rr - fr[i]);
+        double s_diff = std::abs(rs - fs);
+        // same rules as the scalar version, written as selects. s is never stored
+        int fixQ = (q_diff > r_diff) & (q_diff > s_diff);
+        int fixR = !fixQ & (r_diff > s_diff);
+        q[i] = fixQ ? -rr - rs : rq;
+        r[i] = fixR ? -rq - rs : rr;
+    }
+}
+
+//map storage www.redblobgames.com/grids/hexagons/implementation.html#map-storage
+namespace std {
+    template <> struct hash<Hex> {
+        size_t operator()(const Hex& h) const {
+            hash<int> int_hash;
+            size_t hq = int_hash(h.q);
+            size_t hr = int_hash(h.r);
+            return hq ^ (hr + 0x9e3779b9 + (hq << 6) + (hq >> 2));
+        }
+    };
+}
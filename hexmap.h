@@ -0,0 +1,242 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "hex.h"
+#include "terrain.h"
+
+// Per-tile data. The position isn't stored, it's implied by where the tile sits in the HexMap.
+// This is also the on-disk layout of map files (mapfile.h), keep it two plain bytes.
+struct Tile {
+    TileKindId terrain = TILE_KIND_NONE;
+    TileKindId decoration = TILE_KIND_NONE;
+};
+static_assert(sizeof(Tile) == 2, "Tile is read straight out of map files");
+
+// Tiles are stored in square chunks of MAP_CHUNK_SIZE columns x MAP_CHUNK_SIZE rows, chunk after chunk.
+// A chunk is 8KB (two pages), which is the unit map files are paged in and out by.
+const int MAP_CHUNK_SHIFT = 6;
+const int MAP_CHUNK_SIZE = 1 << MAP_CHUNK_SHIFT;
+const int MAP_CHUNK_TILES = MAP_CHUNK_SIZE * MAP_CHUNK_SIZE;
+
+// Hex map stored as one flat array instead of a hash set.
+// https://www.redblobgames.com/grids/hexagons/implementation.html#map-storage
+// We use the "rectangle" shape for flat topped hexes: q is the column and the row is
+// r + floor(q/2), so the map lines up with the window and each row is contiguous in memory.
+// Lookups, neighbors and iteration are all plain index math, no hashing or pointer chasing.
+// Map indices are row by row (row * width + q) no matter how the tiles are stored. The storage is split
+// into chunks found through a small pointer table, so a map can either own its tiles or sit directly on
+// memory it doesn't own (a memory mapped map or save file, a snapshot) and only touch the chunks that
+// are actually used.
+//
+// Borrowed memory is never written: the first writable access to one of its chunks copies that chunk
+// out first, so whatever else is looking at the memory (snapshots, other copies of the map) keeps seeing
+// it unchanged. Writable accesses also stamp their chunk with the current edit epoch, which is how
+// snapshots (snapshot.h) tell which chunks changed since the last one without comparing any tiles.
+class HexMap {
+public:
+    HexMap() : cols(0), rows(0), chunksX(0), chunksY(0) {}
+    HexMap(int width, int height) : cols(width), rows(height) {
+        layoutChunks();
+        owned.resize(static_cast<size_t>(chunksX) * chunksY * MAP_CHUNK_TILES);
+        pointChunks(owned.data());
+    }
+    // Uses chunkMajorTiles in place (chunksWide() * chunksHigh() chunks, row of chunks after row of chunks).
+    // backing keeps that memory alive for as long as the map or any copy of it is around.
+    HexMap(int width, int height, Tile* chunkMajorTiles, std::shared_ptr<void> backing)
+    : cols(width), rows(height), backing(std::move(backing)) {
+        layoutChunks();
+        pointChunks(chunkMajorTiles);
+    }
+    // Same, with every chunk somewhere of its own (chunkPointers[c] is chunk c).
+    HexMap(int width, int height, const std::vector<const Tile*>& chunkPointers, std::shared_ptr<void> backing)
+    : cols(width), rows(height), backing(std::move(backing)) {
+        layoutChunks();
+        chunks.resize(chunkPointers.size());
+        for (size_t c = 0; c < chunks.size(); c++) chunks[c] = const_cast<Tile*>(chunkPointers[c]); // only read, see touch()
+        epochs.assign(chunks.size(), 0);
+    }
+
+    // Copies own their tiles, except copies of a map over borrowed memory which share the chunks that
+    // are still untouched (a copy of a whole continent is never what you want).
+    HexMap(const HexMap& other)
+    : cols(other.cols), rows(other.rows), chunksX(other.chunksX), chunksY(other.chunksY), epochs(other.epochs),
+      epoch(other.epoch), backing(other.backing) {
+        if (other.owned.empty()) {
+            chunks = other.chunks;
+            if (!other.copied.empty()) {
+                copied.resize(other.copied.size());
+                for (size_t c = 0; c < copied.size(); c++) {
+                    if (!other.copied[c]) continue;
+                    copied[c].reset(new Tile[MAP_CHUNK_TILES]);
+                    std::copy(other.chunks[c], other.chunks[c] + MAP_CHUNK_TILES, copied[c].get());
+                    chunks[c] = copied[c].get();
+                }
+            }
+        } else {
+            owned = other.owned;
+            pointChunks(owned.data());
+            epochs = other.epochs;
+        }
+    }
+    HexMap& operator=(const HexMap& other) {
+        if (this != &other) *this = HexMap(other);
+        return *this;
+    }
+    // moving a vector keeps its buffer, so the chunk pointers stay valid
+    HexMap(HexMap&&) = default;
+    HexMap& operator=(HexMap&&) = default;
+
+    int width() const { return cols; }
+    int height() const { return rows; }
+    int size() const { return cols * rows; }
+
+    // true when the tiles live in memory the map doesn't own (a mapped file, a snapshot)
+    bool mapped() const { return backing != nullptr; }
+    const std::shared_ptr<void>& backingMemory() const { return backing; }
+
+    int chunksWide() const { return chunksX; }
+    int chunksHigh() const { return chunksY; }
+    int chunkCount() const { return static_cast<int>(chunks.size()); }
+    // the chunk a tile is stored in
+    int chunkOf(int i) const {
+        int q = i % cols;
+        int row = i / cols;
+        return (row >> MAP_CHUNK_SHIFT) * chunksX + (q >> MAP_CHUNK_SHIFT);
+    }
+    // MAP_CHUNK_TILES tiles, row by row within the chunk
+    Tile* chunkTiles(int chunk) {
+        touch(chunk);
+        return chunks[chunk];
+    }
+    const Tile* chunkTiles(int chunk) const { return chunks[chunk]; }
+
+    // Edit epochs. A chunk's epoch is the last one it was accessed writable in, 0 if it never was since the
+    // map was made (for a map over borrowed memory: the chunk is still the borrowed one).
+    // nextEpoch() ends the current epoch and returns it, writes after that count as newer.
+    uint32_t chunkEpoch(int chunk) const { return epochs[chunk]; }
+    uint32_t nextEpoch() { return epoch++; }
+    // tells maps apart, epochs of two different maps (a copy is a different map) mean nothing to each other
+    uint64_t identity() const { return id; }
+
+    // index of a hex in the flat array, -1 if it's outside the map
+    int index(int q, int r) const {
+        if (q < 0 || q >= cols) return -1;
+        int row = r + (q >> 1);
+        if (row < 0 || row >= rows) return -1;
+        return row * cols + q;
+    }
+    int index(Hex h) const { return index(h.q, h.r); }
+
+    bool contains(Hex h) const { return index(h) >= 0; }
+
+    Hex hexAt(int i) const {
+        int q = i % cols;
+        int row = i / cols;
+        return Hex(q, row - (q >> 1));
+    }
+
+    Tile& operator[](int i) {
+        int q = i % cols;
+        int row = i / cols;
+        touch((row >> MAP_CHUNK_SHIFT) * chunksX + (q >> MAP_CHUNK_SHIFT));
+        return at(q, row);
+    }
+    const Tile& operator[](int i) const { return at(i % cols, i / cols); }
+
+    // nullptr if the hex is off the map
+    Tile* find(Hex h) {
+        int i = index(h);
+        return i < 0 ? nullptr : &(*this)[i];
+    }
+    const Tile* find(Hex h) const {
+        int i = index(h);
+        return i < 0 ? nullptr : &(*this)[i];
+    }
+
+    // index of the neighbor of tile i in one of the six hex_direction()s, -1 if it's off the map
+    int neighbor(int i, int direction) const {
+        int q = i % cols;
+        int row = i / cols;
+        int nq = q + HEX_DIRECTION_Q[direction];
+        // moving a column changes floor(q/2) for odd->even steps, so fix the row up
+        int nrow = row + HEX_DIRECTION_R[direction] + (nq >> 1) - (q >> 1);
+        if (nq < 0 || nq >= cols || nrow < 0 || nrow >= rows) return -1;
+        return nrow * cols + nq;
+    }
+
+    // in-order (row by row) iteration over every tile together with its hex
+    template <typename TileT>
+    struct Cell {
+        Hex hex;
+        TileT& tile;
+    };
+    template <typename MapT, typename TileT>
+    class Iterator {
+    public:
+        Iterator(MapT* map, int i) : map(map), i(i) {}
+        Cell<TileT> operator*() const { return Cell<TileT>{map->hexAt(i), (*map)[i]}; }
+        Iterator& operator++() { i++; return *this; }
+        bool operator!=(const Iterator& other) const { return i != other.i; }
+    private:
+        MapT* map;
+        int i;
+    };
+    Iterator<HexMap, Tile> begin() { return {this, 0}; }
+    Iterator<HexMap, Tile> end() { return {this, size()}; }
+    Iterator<const HexMap, const Tile> begin() const { return {this, 0}; }
+    Iterator<const HexMap, const Tile> end() const { return {this, size()}; }
+
+private:
+    static uint64_t newIdentity() {
+        static std::atomic<uint64_t> next{1};
+        return next.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // q is the column, row the storage row
+    Tile& at(int q, int row) const {
+        const int mask = MAP_CHUNK_SIZE - 1;
+        Tile* chunk = chunks[(row >> MAP_CHUNK_SHIFT) * chunksX + (q >> MAP_CHUNK_SHIFT)];
+        return chunk[((row & mask) << MAP_CHUNK_SHIFT) | (q & mask)];
+    }
+
+    void layoutChunks() {
+        chunksX = (cols + MAP_CHUNK_SIZE - 1) >> MAP_CHUNK_SHIFT;
+        chunksY = (rows + MAP_CHUNK_SIZE - 1) >> MAP_CHUNK_SHIFT;
+    }
+
+    void pointChunks(Tile* first) {
+        chunks.resize(static_cast<size_t>(chunksX) * chunksY);
+        for (size_t c = 0; c < chunks.size(); c++) chunks[c] = first + c * MAP_CHUNK_TILES;
+        epochs.assign(chunks.size(), 0);
+    }
+
+    // before handing out a chunk writable: stamp it, and copy it out of borrowed memory the first time
+    void touch(int chunk) {
+        if (epochs[chunk] != epoch) stamp(chunk);
+    }
+
+    void stamp(int chunk) {
+        if (epochs[chunk] == 0 && backing != nullptr) {
+            if (copied.empty()) copied.resize(chunks.size());
+            copied[chunk].reset(new Tile[MAP_CHUNK_TILES]);
+            std::copy(chunks[chunk], chunks[chunk] + MAP_CHUNK_TILES, copied[chunk].get());
+            chunks[chunk] = copied[chunk].get();
+        }
+        epochs[chunk] = epoch;
+    }
+
+    int cols;
+    int rows;
+    int chunksX;
+    int chunksY;
+    std::vector<Tile*> chunks;      // chunk -> its MAP_CHUNK_TILES tiles
+    std::vector<uint32_t> epochs;   // per chunk, see chunkEpoch()
+    uint32_t epoch = 1;
+    uint64_t id = newIdentity();
+    std::vector<Tile> owned;        // the tiles, unless they live in borrowed memory
+    std::vector<std::unique_ptr<Tile[]>> copied; // chunks copied out of borrowed memory once written
+    std::shared_ptr<void> backing;  // keeps the borrowed memory alive
+};
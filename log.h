@@ -0,0 +1,176 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+// Leveled logging that stays off the hot path.
+//   LOG_INFO("Number of rows: %d", numRows);
+// - levels below LOG_MIN_LEVEL compile to nothing, arguments included (define it before including
+//   this header or with -DLOG_MIN_LEVEL=0 to get the trace spam back)
+// - enabled calls format into a slot of a fixed lock-free ring buffer and return, no locks, no I/O
+// - a background thread drains the ring and does the actual writes, flushing once per batch
+// If the ring is full the message is dropped and counted rather than blocking the game.
+
+#define LOG_LEVEL_TRACE 0
+#define LOG_LEVEL_DEBUG 1
+#define LOG_LEVEL_INFO 2
+#define LOG_LEVEL_WARN 3
+#define LOG_LEVEL_ERROR 4
+
+#ifndef LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define LOG_MIN_LEVEL LOG_LEVEL_INFO
+#else
+#define LOG_MIN_LEVEL LOG_LEVEL_DEBUG
+#endif
+#endif
+
+const int LOG_LINE_MAX = 240;
+const size_t LOG_RING_SIZE = 1024; // must be a power of two
+
+struct LogRecord {
+    std::atomic<size_t> sequence;
+    int level;
+    double seconds; // since the logger started
+    char text[LOG_LINE_MAX];
+};
+
+class Logger {
+public:
+    Logger() : sink(stdout), start(std::chrono::steady_clock::now()) {
+        for (size_t i = 0; i < LOG_RING_SIZE; i++) ring[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+    ~Logger() { stop(); }
+
+    // Where the flusher writes to, stdout by default. Set it before the first message.
+    void setSink(FILE* file) { sink = file; }
+
+    // Multi producer enqueue (Vyukov's bounded queue): claim a slot by bumping writePos, fill it,
+    // then publish it by bumping its sequence number.
+    void write(int level, const char* format, va_list args) {
+        ensureStarted();
+        size_t pos = writePos.load(std::memory_order_relaxed);
+        LogRecord* slot;
+        for (;;) {
+            slot = &ring[pos & (LOG_RING_SIZE - 1)];
+            size_t seq = slot->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (writePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            } else {
+                pos = writePos.load(std::memory_order_relaxed);
+            }
+        }
+        slot->level = level;
+        slot->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        vsnprintf(slot->text, LOG_LINE_MAX, format, args);
+        slot->sequence.store(pos + 1, std::memory_order_release);
+    }
+
+    // Writes out whatever is queued and stops the flusher. Safe to call more than once.
+    void stop() {
+        std::lock_guard<std::mutex> lock(startMutex);
+        if (!flusher.joinable()) return;
+        running.store(false, std::memory_order_release);
+        flusher.join();
+    }
+
+private:
+    void ensureStarted() {
+        if (running.load(std::memory_order_acquire)) return;
+        std::lock_guard<std::mutex> lock(startMutex);
+        if (flusher.joinable()) return;
+        running.store(true, std::memory_order_release);
+        flusher = std::thread([this] { flushLoop(); });
+    }
+
+    // single consumer, so no CAS needed on readPos
+    bool drain() {
+        bool wrote = false;
+        for (;;) {
+            LogRecord& slot = ring[readPos & (LOG_RING_SIZE - 1)];
+            size_t seq = slot.sequence.load(std::memory_order_acquire);
+            if (seq != readPos + 1) break;
+            static const char* names[] = {"TRACE", "DEBUG", "INFO", "WARN", "ERROR"};
+            fprintf(sink, "[%9.3f] %-5s %s\n", slot.seconds, names[slot.level], slot.text);
+            slot.sequence.store(readPos + LOG_RING_SIZE, std::memory_order_release);
+            readPos++;
+            wrote = true;
+        }
+        size_t lost = dropped.exchange(0, std::memory_order_relaxed);
+        if (lost != 0) {
+            fprintf(sink, "[log] dropped %zu messages, ring buffer was full\n", lost);
+            wrote = true;
+        }
+        if (wrote) fflush(sink);
+        return wrote;
+    }
+
+    void flushLoop() {
+        while (running.load(std::memory_order_acquire)) {
+            if (!drain()) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        drain();
+    }
+
+    LogRecord ring[LOG_RING_SIZE];
+    alignas(64) std::atomic<size_t> writePos{0};
+    alignas(64) size_t readPos = 0;
+    std::atomic<size_t> dropped{0};
+    std::atomic<bool> running{false};
+    std::mutex startMutex;
+    std::thread flusher;
+    FILE* sink;
+    std::chrono::steady_clock::time_point start;
+};
+
+inline Logger& logger() {
+    static Logger instance;
+    return instance;
+}
+
+#if defined(__GNUC__)
+__attribute__((format(printf, 2, 3)))
+#endif
+inline void logWrite(int level, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    logger().write(level, format, args);
+    va_end(args);
+}
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_TRACE
+#define LOG_TRACE(...) logWrite(LOG_LEVEL_TRACE, __VA_ARGS__)
+#else
+#define LOG_TRACE(...) ((void)0)
+#endif
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) logWrite(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) ((void)0)
+#endif
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(...) logWrite(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) ((void)0)
+#endif
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_WARN
+#define LOG_WARN(...) logWrite(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) ((void)0)
+#endif
+
+#define LOG_ERROR(...) logWrite(LOG_LEVEL_ERROR, __VA_ARGS__)
@@ -0,0 +1,313 @@
+#pragma once
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include "hex.h"
+#include "hexmap.h"
+#include "terrain.h"
+#include "entities.h"
+#include "camera.h"
+#include "log.h"
+
+// Binary map files.
+// The tiles are stored exactly the way HexMap keeps them in memory (chunk after chunk of two byte Tiles),
+// so loading a map is an mmap and nothing is read or copied up front: pages come in from disk the first
+// time a chunk is touched. Edits never reach the file, an edited chunk is copied out of it first (hexmap.h).
+// MapStreamer keeps the chunks around the camera paged in and lets the kernel drop the rest, so a map
+// much bigger than memory works fine as long as the part being looked at fits.
+//
+// Layout (little endian, offsets from the start of the file):
+//   MapFileHeader
+//   names       terrain names then decoration names, each '\0' terminated, in id order starting with "none"
+//   spawns      spawnCount MapSpawns
+//   tiles       at tilesOffset (page aligned), chunksX * chunksY chunks of MAP_CHUNK_TILES Tiles
+// Bump MAP_FILE_VERSION whenever any of this changes, old files are refused rather than misread.
+// tools/mapconv.cpp turns text maps into this.
+
+const char MAP_FILE_MAGIC[4] = {'U', 'N', 'G', 'M'};
+const uint32_t MAP_FILE_VERSION = 1;
+const uint64_t MAP_FILE_ALIGN = 4096;
+
+struct MapFileHeader {
+    char magic[4];
+    uint32_t version;
+    int32_t width;
+    int32_t height;
+    uint32_t chunkSize;        // MAP_CHUNK_SIZE when written, has to match
+    uint32_t chunksX;
+    uint32_t chunksY;
+    uint32_t terrainCount;
+    uint32_t decorationCount;
+    uint32_t spawnCount;
+    uint64_t namesOffset;
+    uint64_t spawnsOffset;
+    uint64_t tilesOffset;
+    uint64_t fileSize;
+};
+
+// where a unit starts, team and class are Team / UnitClass from entities.h
+struct MapSpawn {
+    int32_t q;
+    int32_t r;
+    uint8_t team;
+    uint8_t unitClass;
+    uint8_t padding[2];
+};
+
+// Writes a map file. The kind names come from the registries so the file's ids are the map's ids.
+inline bool writeMapFile(const char* path, const HexMap& map, const TileRegistry& terrain,
+                         const TileRegistry& decorations, const std::vector<MapSpawn>& spawns) {
+    std::string names;
+    for (int i = 0; i < terrain.size(); i++) names += terrain.name(static_cast<TileKindId>(i)) + '\0';
+    for (int i = 0; i < decorations.size(); i++) names += decorations.name(static_cast<TileKindId>(i)) + '\0';
+
+    MapFileHeader header;
+    memcpy(header.magic, MAP_FILE_MAGIC, sizeof(header.magic));
+    header.version = MAP_FILE_VERSION;
+    header.width = map.width();
+    header.height = map.height();
+    header.chunkSize = MAP_CHUNK_SIZE;
+    header.chunksX = map.chunksWide();
+    header.chunksY = map.chunksHigh();
+    header.terrainCount = terrain.size();
+    header.decorationCount = decorations.size();
+    header.spawnCount = static_cast<uint32_t>(spawns.size());
+    header.namesOffset = sizeof(MapFileHeader);
+    header.spawnsOffset = header.namesOffset + names.size();
+    uint64_t spawnsEnd = header.spawnsOffset + spawns.size() * sizeof(MapSpawn);
+    header.tilesOffset = (spawnsEnd + MAP_FILE_ALIGN - 1) / MAP_FILE_ALIGN * MAP_FILE_ALIGN;
+    header.fileSize = header.tilesOffset + static_cast<uint64_t>(map.chunkCount()) * MAP_CHUNK_TILES * sizeof(Tile);
+
+    FILE* file = fopen(path, "wb");
+    if (file == nullptr) {
+        LOG_ERROR("Can't write map file %s", path);
+        return false;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    ok = ok && fwrite(names.data(), 1, names.size(), file) == names.size();
+    ok = ok && (spawns.empty() || fwrite(spawns.data(), sizeof(MapSpawn), spawns.size(), file) == spawns.size());
+    std::vector<char> padding(header.tilesOffset - spawnsEnd, 0);
+    ok = ok && (padding.empty() || fwrite(padding.data(), 1, padding.size(), file) == padding.size());
+    for (int c = 0; ok && c < map.chunkCount(); c++) {
+        ok = fwrite(map.chunkTiles(c), sizeof(Tile), MAP_CHUNK_TILES, file) == static_cast<size_t>(MAP_CHUNK_TILES);
+    }
+    ok = (fclose(file) == 0) && ok;
+    if (!ok) LOG_ERROR("Failed writing map file %s", path);
+    return ok;
+}
+
+// A mapped map file. Cheap to open no matter the size, only the header, names and spawns are read.
+class MapFile {
+public:
+    bool open(const char* path) {
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) {
+            LOG_ERROR("Can't open map file %s", path);
+            return false;
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(MapFileHeader)) {
+            LOG_ERROR("Map file %s is too small to be a map", path);
+            ::close(fd);
+            return false;
+        }
+        size_t length = static_cast<size_t>(info.st_size);
+        // the map copies a chunk out before writing to it (hexmap.h), so a write into the file is a bug and faults
+        void* base = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (base == MAP_FAILED) {
+            LOG_ERROR("Can't map map file %s", path);
+            return false;
+        }
+        mapping = std::shared_ptr<void>(base, [length](void* p) { munmap(p, length); });
+
+        const char* bytes = static_cast<const char*>(base);
+        memcpy(&header, bytes, sizeof(header));
+        if (memcmp(header.magic, MAP_FILE_MAGIC, sizeof(header.magic)) != 0 || header.version != MAP_FILE_VERSION) {
+            LOG_ERROR("%s isn't a version %u map file", path, MAP_FILE_VERSION);
+            return close();
+        }
+        uint64_t tileBytes = static_cast<uint64_t>(header.chunksX) * header.chunksY * MAP_CHUNK_TILES * sizeof(Tile);
+        if (header.chunkSize != MAP_CHUNK_SIZE || header.width <= 0 || header.height <= 0
+            || header.chunksX != static_cast<uint32_t>((header.width + MAP_CHUNK_SIZE - 1) >> MAP_CHUNK_SHIFT)
+            || header.chunksY != static_cast<uint32_t>((header.height + MAP_CHUNK_SIZE - 1) >> MAP_CHUNK_SHIFT)
+            || header.tilesOffset % MAP_FILE_ALIGN != 0 || header.fileSize != length || header.tilesOffset > length
+            || static_cast<int64_t>(header.width) * header.height > INT32_MAX
+            || header.tilesOffset + tileBytes != length
+            || header.namesOffset < sizeof(MapFileHeader) || header.namesOffset > header.spawnsOffset
+            || header.spawnsOffset > header.tilesOffset
+            || header.spawnsOffset + static_cast<uint64_t>(header.spawnCount) * sizeof(MapSpawn) > header.tilesOffset
+            || header.terrainCount == 0 || header.terrainCount > TILE_KIND_LIMIT
+            || header.decorationCount == 0 || header.decorationCount > TILE_KIND_LIMIT) {
+            LOG_ERROR("Map file %s is corrupt or was written with a different chunk size", path);
+            return close();
+        }
+
+        terrainNames.clear();
+        decorationNames.clear();
+        const char* name = bytes + header.namesOffset;
+        const char* namesEnd = bytes + header.spawnsOffset;
+        for (uint32_t i = 0; i < header.terrainCount + header.decorationCount; i++) {
+            size_t n = strnlen(name, namesEnd - name);
+            if (name + n >= namesEnd) {
+                LOG_ERROR("Map file %s has a broken name table", path);
+                return close();
+            }
+            (i < header.terrainCount ? terrainNames : decorationNames).emplace_back(name, n);
+            name += n + 1;
+        }
+        spawns.resize(header.spawnCount);
+        if (!spawns.empty()) memcpy(spawns.data(), bytes + header.spawnsOffset, spawns.size() * sizeof(MapSpawn));
+        for (const MapSpawn& spawn : spawns) {
+            if (spawn.team > TEAM_ENEMY || spawn.unitClass >= CLASS_COUNT || !onMap(spawn.q, spawn.r)) {
+                LOG_ERROR("Map file %s has a spawn off the map or with an unknown team or class", path);
+                return close();
+            }
+        }
+        LOG_INFO("Mapped %s: %dx%d tiles, %ux%u chunks", path, header.width, header.height, header.chunksX, header.chunksY);
+        return true;
+    }
+
+    // Registers the file's kinds into the registries so tile ids in the file mean the same thing in the game.
+    // Call it before registering anything else (sprites can be attached by name afterwards, add() keeps the id).
+    bool registerKinds(TileRegistry& terrain, TileRegistry& decorations) const {
+        for (size_t i = 0; i < terrainNames.size(); i++) {
+            if (terrain.add(terrainNames[i]) != static_cast<TileKindId>(i)) return kindMismatch(terrainNames[i]);
+        }
+        for (size_t i = 0; i < decorationNames.size(); i++) {
+            if (decorations.add(decorationNames[i]) != static_cast<TileKindId>(i)) return kindMismatch(decorationNames[i]);
+        }
+        return true;
+    }
+
+    // The map, straight on top of the file. Keeps the mapping alive on its own.
+    HexMap map() const {
+        if (!mapping) return HexMap();
+        Tile* tiles = reinterpret_cast<Tile*>(static_cast<char*>(mapping.get()) + header.tilesOffset);
+        return HexMap(header.width, header.height, tiles, mapping);
+    }
+
+    int width() const { return header.width; }
+    int height() const { return header.height; }
+
+    std::vector<std::string> terrainNames;
+    std::vector<std::string> decorationNames;
+    std::vector<MapSpawn> spawns;
+
+private:
+    bool close() {
+        mapping.reset();
+        return false;
+    }
+
+    // same as HexMap::index() >= 0
+    bool onMap(int q, int r) const {
+        int row = r + (q >> 1);
+        return q >= 0 && q < header.width && row >= 0 && row < header.height;
+    }
+
+    static bool kindMismatch(const std::string& name) {
+        LOG_ERROR("Map kind '%s' got a different id than in the file, load the map before registering kinds", name.c_str());
+        return false;
+    }
+
+    MapFileHeader header = {};
+    std::shared_ptr<void> mapping;
+};
+
+// Keeps the chunks near the camera resident for a map that lives in a mapped file.
+// Chunks that come within range are prefetched in the background (MADV_WILLNEED), chunks that fall
+// out of range are handed back to the kernel. Clean pages are just dropped and read again if needed,
+// edited ones go to swap (MADV_PAGEOUT) so nothing is lost. Maps that own their tiles don't need this.
+class MapStreamer {
+public:
+    // marginChunks extra chunks are kept on every side of the visible ones, so panning doesn't wait on the disk
+    explicit MapStreamer(int marginChunks = 1) : margin(marginChunks) {}
+
+    // Call when the camera moved. Cheap when it stays within the same chunks.
+    void update(const HexMap& map, const Layout& layout, const Camera& camera, int spriteW, int spriteH) {
+        if (!map.mapped()) return;
+        if (static_cast<int>(resident.size()) != map.chunkCount()) {
+            resident.assign(map.chunkCount(), 0);
+            lastX0 = lastY0 = lastX1 = lastY1 = -1;
+        }
+        // chunk rectangle covering every visible tile
+        int x0 = map.chunksWide(), y0 = map.chunksHigh(), x1 = -1, y1 = -1;
+        forEachVisibleHex(map, layout, camera, spriteW, spriteH, [&](int i, Hex) {
+            int c = map.chunkOf(i);
+            int cx = c % map.chunksWide();
+            int cy = c / map.chunksWide();
+            x0 = std::min(x0, cx);
+            y0 = std::min(y0, cy);
+            x1 = std::max(x1, cx);
+            y1 = std::max(y1, cy);
+        });
+        if (x1 < 0) return;
+        x0 = std::max(0, x0 - margin);
+        y0 = std::max(0, y0 - margin);
+        x1 = std::min(map.chunksWide() - 1, x1 + margin);
+        y1 = std::min(map.chunksHigh() - 1, y1 + margin);
+        if (x0 == lastX0 && y0 == lastY0 && x1 == lastX1 && y1 == lastY1) return;
+        lastX0 = x0;
+        lastY0 = y0;
+        lastX1 = x1;
+        lastY1 = y1;
+
+        // release first so the old list can be reused for the new set
+        for (size_t k = 0; k < residentList.size();) {
+            int c = residentList[k];
+            int cx = c % map.chunksWide();
+            int cy = c / map.chunksWide();
+            if (cx >= x0 && cx <= x1 && cy >= y0 && cy <= y1) {
+                k++;
+                continue;
+            }
+            advise(map.chunkTiles(c), false);
+            resident[c] = 0;
+            residentList[k] = residentList.back();
+            residentList.pop_back();
+        }
+        for (int cy = y0; cy <= y1; cy++) {
+            for (int cx = x0; cx <= x1; cx++) {
+                int c = cy * map.chunksWide() + cx;
+                if (resident[c]) continue;
+                advise(map.chunkTiles(c), true);
+                resident[c] = 1;
+                residentList.push_back(c);
+            }
+        }
+    }
+
+    int residentChunks() const { return static_cast<int>(residentList.size()); }
+
+private:
+    static void advise(const Tile* chunk, bool wanted) {
+        static const uintptr_t pageSize = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+        void* start = const_cast<Tile*>(chunk);
+        if (reinterpret_cast<uintptr_t>(start) % pageSize != 0) return; // pages bigger than a chunk
+        size_t length = MAP_CHUNK_TILES * sizeof(Tile);
+        if (wanted) {
+            madvise(start, length, MADV_WILLNEED);
+        } else {
+#if defined(MADV_PAGEOUT)
+            madvise(start, length, MADV_PAGEOUT);
+#elif defined(MADV_COLD)
+            madvise(start, length, MADV_COLD);
+#endif
+        }
+    }
+
+    int margin;
+    int lastX0 = -1, lastY0 = -1, lastX1 = -1, lastY1 = -1;
+    std::vector<uint8_t> resident;  // per chunk
+    std::vector<int> residentList;
+};
@@ -0,0 +1,209 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "hex.h"
+#include "hexmap.h"
+#include "terrain.h"
+#include "rng.h"
+#include "threadpool.h"
+#include "visibility.h"
+
+// Procedural maps.
+// Three noise fields over the hex grid (elevation, temperature, moisture) pick a biome per tile:
+//   low ground         -> reef (shallow water, slow)
+//   cold               -> tundra
+//   hot and wet        -> rainforest
+//   wet and low        -> swamp
+//   anything else      -> plain
+// then decorations are scattered per biome and each chunk gets a shot at an objective.
+//
+// The noise is a pure function of (seed, position), so it's seamless across chunk borders and doesn't care
+// which thread asks. Everything random that isn't noise comes from a Pcg32 on the chunk's own stream, so
+// the chunks are generated independently on a ThreadPool and the result is the same for a seed no matter
+// how many threads there are or which order they finish in.
+
+struct MapGenSettings {
+    uint64_t seed = 0;
+    float featureSize = 12.0f;   // roughly how many tiles across a biome blob is
+    float seaLevel = 0.34f;      // elevation below this is reef
+    int objectivesPerChunk = 1;  // tries, a try fails if it lands in the water
+};
+
+// Kind ids the generator writes, from registerBiomes().
+struct BiomeKinds {
+    TileKindId plain;
+    TileKindId tundra;
+    TileKindId rainforest;
+    TileKindId reef;
+    TileKindId swamp;
+    TileKindId birch;
+    TileKindId tree;
+    TileKindId objective;
+};
+
+// Registers (or looks up) everything the generator places and fills in the gameplay properties.
+// Sprites are left alone, register the names with their atlas regions before or after this.
+inline BiomeKinds registerBiomes(TileRegistry& terrain, TileRegistry& decorations) {
+    BiomeKinds k;
+    k.plain = terrain.add("plain");
+    k.tundra = terrain.add("tundra");
+    k.rainforest = terrain.add("rainforest");
+    k.reef = terrain.add("reef");
+    k.swamp = terrain.add("swamp");
+    k.birch = decorations.add("birch");
+    k.tree = decorations.add("tree");
+    k.objective = decorations.add("objective");
+
+    terrain.kind(k.plain).moveCost = 1;
+    terrain.kind(k.tundra).moveCost = 1;
+    terrain.kind(k.rainforest).moveCost = 1;
+    terrain.kind(k.reef).moveCost = 3;
+    terrain.kind(k.swamp).moveCost = 2;
+    decorations.kind(k.tree).moveCost = 1;
+    decorations.kind(k.tree).blocksSight = true;
+    decorations.kind(k.tree).cover = COVER_FULL;
+    decorations.kind(k.birch).cover = COVER_HALF;
+    return k;
+}
+
+// Smoothed value noise with a few octaves, 0..1. x and y are in hex-size units (hex_to_pixel with size 1).
+class MapNoise {
+public:
+    MapNoise(uint64_t seed, uint32_t field) : salt(static_cast<uint32_t>(seed ^ (seed >> 32)) * 0x9E3779B1u + field * 0x85EBCA77u) {}
+
+    float operator()(float x, float y) const {
+        float total = 0.0f;
+        float amplitude = 1.0f;
+        float norm = 0.0f;
+        for (int octave = 0; octave < OCTAVES; octave++) {
+            total += amplitude * value(x, y, static_cast<uint32_t>(octave));
+            norm += amplitude;
+            amplitude *= 0.5f;
+            x *= 2.0f;
+            y *= 2.0f;
+        }
+        return total / norm;
+    }
+
+private:
+    static const int OCTAVES = 4;
+
+    float value(float x, float y, uint32_t octave) const {
+        float fx = std::floor(x);
+        float fy = std::floor(y);
+        int32_t ix = static_cast<int32_t>(fx);
+        int32_t iy = static_cast<int32_t>(fy);
+        float tx = x - fx;
+        float ty = y - fy;
+        // smoothstep so the lattice doesn't show
+        tx = tx * tx * (3.0f - 2.0f * tx);
+        ty = ty * ty * (3.0f - 2.0f * ty);
+        float a = lattice(ix, iy, octave);
+        float b = lattice(ix + 1, iy, octave);
+        float c = lattice(ix, iy + 1, octave);
+        float d = lattice(ix + 1, iy + 1, octave);
+        float top = a + (b - a) * tx;
+        float bottom = c + (d - c) * tx;
+        return top + (bottom - top) * ty;
+    }
+
+    // integer hash of a lattice point, 0..1
+    float lattice(int32_t x, int32_t y, uint32_t octave) const {
+        uint32_t h = salt ^ (static_cast<uint32_t>(x) * 0x27D4EB2Du) ^ (static_cast<uint32_t>(y) * 0x165667B1u) ^ (octave * 0xC2B2AE3Du);
+        h ^= h >> 15;
+        h *= 0x2C1B3C6Du;
+        h ^= h >> 12;
+        h *= 0x297A2D39u;
+        h ^= h >> 15;
+        return (h >> 8) * (1.0f / 16777216.0f);
+    }
+
+    uint32_t salt;
+};
+
+class MapGenerator {
+public:
+    MapGenerator(const BiomeKinds& kinds, const MapGenSettings& settings)
+    : kinds(kinds), settings(settings),
+      elevation(settings.seed, 0), temperature(settings.seed, 1), moisture(settings.seed, 2) {}
+
+    // Fills every tile of map and returns the objective tiles (map indices, in chunk order).
+    // With a pool the chunks are spread over its threads, without one they're done right here.
+    std::vector<int> generate(HexMap& map, ThreadPool* pool = nullptr) const {
+        std::vector<std::vector<int>> perChunk(map.chunkCount());
+        for (int c = 0; c < map.chunkCount(); c++) {
+            if (pool != nullptr) pool->submit([this, &map, &perChunk, c] { generateChunk(map, c, perChunk[c]); });
+            else generateChunk(map, c, perChunk[c]);
+        }
+        if (pool != nullptr) pool->wait();
+        std::vector<int> objectives;
+        for (const std::vector<int>& found : perChunk) objectives.insert(objectives.end(), found.begin(), found.end());
+        return objectives;
+    }
+
+    // The biome at a hex, without generating anything. Same answer generate() gives for that tile.
+    TileKindId biomeAt(Hex h) const {
+        float x, y;
+        noisePosition(h.q, h.r, x, y);
+        float e = elevation(x, y);
+        if (e < settings.seaLevel) return kinds.reef;
+        // temperature is stretched so there's some real tundra and rainforest, not just plain
+        float t = temperature(x * 0.5f, y * 0.5f);
+        float m = moisture(x, y);
+        if (t < 0.38f) return kinds.tundra;
+        if (t > 0.55f && m > 0.52f) return kinds.rainforest;
+        if (m > 0.56f && e < settings.seaLevel + 0.1f) return kinds.swamp;
+        return kinds.plain;
+    }
+
+private:
+    void noisePosition(int q, int r, float& x, float& y) const {
+        // flat topped hex centers with size 1, scaled so featureSize tiles are one noise cell
+        const float scale = 1.0f / settings.featureSize;
+        x = 1.5f * q * scale;
+        y = 1.7320508f * (r + 0.5f * q) * scale;
+    }
+
+    void generateChunk(HexMap& map, int chunk, std::vector<int>& objectives) const {
+        Pcg32 rng(settings.seed, static_cast<uint64_t>(chunk));
+        Tile* tiles = map.chunkTiles(chunk);
+        int q0 = (chunk % map.chunksWide()) << MAP_CHUNK_SHIFT;
+        int row0 = (chunk / map.chunksWide()) << MAP_CHUNK_SHIFT;
+        int q1 = std::min(map.width(), q0 + MAP_CHUNK_SIZE);
+        int row1 = std::min(map.height(), row0 + MAP_CHUNK_SIZE);
+        for (int row = row0; row < row1; row++) {
+            Tile* line = tiles + ((row - row0) << MAP_CHUNK_SHIFT);
+            for (int q = q0; q < q1; q++) {
+                Tile& tile = line[q - q0];
+                tile.terrain = biomeAt(Hex(q, row - (q >> 1)));
+                tile.decoration = decorate(tile.terrain, rng);
+            }
+        }
+        for (int k = 0; k < settings.objectivesPerChunk; k++) {
+            int q = rng.range(q0, q1 - 1);
+            int row = rng.range(row0, row1 - 1);
+            Tile& tile = tiles[((row - row0) << MAP_CHUNK_SHIFT) | (q - q0)];
+            if (tile.terrain == kinds.reef) continue;
+            tile.decoration = kinds.objective;
+            objectives.push_back(row * map.width() + q);
+        }
+    }
+
+    TileKindId decorate(TileKindId biome, Pcg32& rng) const {
+        uint32_t roll = rng.below(100);
+        if (biome == kinds.rainforest) return roll < 45 ? kinds.tree : (roll < 55 ? kinds.birch : TILE_KIND_NONE);
+        if (biome == kinds.tundra) return roll < 8 ? kinds.birch : TILE_KIND_NONE;
+        if (biome == kinds.swamp) return roll < 12 ? kinds.birch : (roll < 15 ? kinds.tree : TILE_KIND_NONE);
+        if (biome == kinds.plain) return roll < 5 ? kinds.tree : (roll < 10 ? kinds.birch : TILE_KIND_NONE);
+        return TILE_KIND_NONE;
+    }
+
+    BiomeKinds kinds;
+    MapGenSettings settings;
+    MapNoise elevation;
+    MapNoise temperature;
+    MapNoise moisture;
+};
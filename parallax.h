@@ -0,0 +1,248 @@
+#pragma once
+
+#include <SDL.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "assets.h"
+#include "uilayer.h"
+#include "profiler.h"
+#include "drawcalls.h"
+#include "log.h"
+
+// Parallax backgrounds drawn behind the map, one per location, listed in assets/parallax.txt.
+// A background is a stack of layers of pixel art, each moving at its own fraction of the camera's speed.
+// What a frame costs doesn't depend on how big or detailed the art is:
+// - every layer is scaled once, to its size on screen, and repeated side by side until it's at least as
+//   wide as the screen. That texture wraps around, so scrolling is just where the copy starts in it, and a
+//   layer is at most two unscaled copies a frame
+// - the layers at the back that only move with the camera are composed into one screen-sized texture
+//   (uilayer.h) when the camera stops, so a still camera is one copy for all of them. While the camera
+//   moves they're drawn directly instead of being composed every frame
+// - layers that drift by themselves (clouds) are drawn every frame, and so is every layer in front of one
+// The scaled textures are made again only when the screen size changes.
+//
+// parallax.txt lines look like
+//   background  default
+//   layer       bg-sky-test  0  0  1  0
+// layer is: art (a surface asset from manifest.txt), scroll (fraction of the camera's movement, 0 = fixed to
+// the screen), top and height (fractions of the screen height, at camera 0) and drift (pixels per second).
+// Layers go back to front. Layers touching the top or bottom of the screen stay there when the camera moves.
+
+struct ParallaxLayer {
+    int art;       // index into ParallaxLibrary's surfaces
+    float scroll;
+    float top;
+    float height;
+    float drift;
+    SDL_Texture* texture = nullptr; // scaled and repeated, see prepare()
+    int width = 0;                  // of the texture, at least the screen's
+    int pixelHeight = 0;
+};
+
+struct ParallaxBackground {
+    std::string name;
+    std::vector<ParallaxLayer> layers;
+    int composedLayers = 0; // the ones at the back that don't drift, they can be cached
+};
+
+class ParallaxLibrary {
+public:
+    ParallaxLibrary() = default;
+    ParallaxLibrary(const ParallaxLibrary&) = delete;
+    ParallaxLibrary& operator=(const ParallaxLibrary&) = delete;
+    ~ParallaxLibrary() { destroy(); }
+
+    bool load(const char* path, AssetManager& assets) {
+        std::ifstream in(path);
+        if (!in) {
+            LOG_ERROR("Can't open parallax file %s", path);
+            return false;
+        }
+        std::string line;
+        for (int lineNumber = 1; std::getline(in, line); lineNumber++) {
+            std::istringstream words(line.substr(0, line.find('#')));
+            std::string keyword;
+            if (!(words >> keyword)) continue;
+            if (keyword == "background") {
+                ParallaxBackground background;
+                if (!(words >> background.name)) return error(path, lineNumber, "expected 'background name'");
+                byName[background.name] = static_cast<int>(backgrounds.size());
+                backgrounds.push_back(background);
+            } else if (keyword == "layer") {
+                if (backgrounds.empty()) return error(path, lineNumber, "layer before any background");
+                std::string name;
+                ParallaxLayer layer = {};
+                if (!(words >> name >> layer.scroll >> layer.top >> layer.height >> layer.drift) || layer.height <= 0) {
+                    return error(path, lineNumber, "expected 'layer art scroll top height drift'");
+                }
+                auto found = artByName.find(name);
+                if (found == artByName.end()) {
+                    SDL_Surface* surface = assets.takeSurface(assets.handle(name));
+                    if (surface == nullptr) return error(path, lineNumber, "art isn't a loaded surface asset");
+                    found = artByName.emplace(name, static_cast<int>(surfaces.size())).first;
+                    surfaces.push_back(surface);
+                }
+                layer.art = found->second;
+                ParallaxBackground& background = backgrounds.back();
+                if (layer.drift == 0.0f && background.composedLayers == static_cast<int>(background.layers.size())) {
+                    background.composedLayers++;
+                }
+                background.layers.push_back(layer);
+            } else {
+                return error(path, lineNumber, "unknown keyword");
+            }
+        }
+        return true;
+    }
+
+    // The background drawn from now on. A location without one of its own gets "default", if there is one.
+    void select(const std::string& name) {
+        auto found = byName.find(name);
+        if (found == byName.end()) found = byName.find("default");
+        int next = found == byName.end() ? -1 : found->second;
+        if (next == current) return;
+        releaseTextures();
+        current = next;
+    }
+
+    // drifting layers move with the simulation, not the frame rate
+    void update(double dt) { time += dt; }
+
+    // render targets are gone after SDL_RENDER_TARGETS_RESET / SDL_RENDER_DEVICE_RESET, and with
+    // a device reset the scaled textures too
+    void invalidate() {
+        releaseTextures();
+    }
+
+    // Draws the background over the whole screen for a camera at (cameraX, cameraY).
+    void draw(SDL_Renderer* renderer, double cameraX, double cameraY) {
+        if (current < 0) return;
+        PROFILE_ZONE("background");
+        ParallaxBackground& background = backgrounds[current];
+        int w, h;
+        SDL_GetRendererOutputSize(renderer, &w, &h);
+        if (w != screenW || h != screenH) {
+            releaseTextures();
+            screenW = w;
+            screenH = h;
+        }
+        int x = static_cast<int>(std::floor(cameraX));
+        int y = static_cast<int>(std::floor(cameraY));
+        bool still = x == lastX && y == lastY;
+        lastX = x;
+        lastY = y;
+
+        int first = 0;
+        if (still && background.composedLayers > 0) {
+            if (composed.begin(renderer, w, h)) {
+                for (int i = 0; i < background.composedLayers; i++) drawLayer(renderer, background.layers[i], x, y);
+                composed.end(renderer);
+            }
+            // without the composed texture they're drawn directly like while moving
+            if (composed.ready()) {
+                composed.draw(renderer);
+                first = background.composedLayers;
+            }
+        } else {
+            composed.invalidate();
+        }
+        for (int i = first; i < static_cast<int>(background.layers.size()); i++) drawLayer(renderer, background.layers[i], x, y);
+    }
+
+    void destroy() {
+        releaseTextures();
+        for (SDL_Surface* s : surfaces) SDL_FreeSurface(s);
+        surfaces.clear();
+        artByName.clear();
+        backgrounds.clear();
+        byName.clear();
+        current = -1;
+    }
+
+private:
+    static bool error(const char* path, int line, const char* what) {
+        LOG_ERROR("%s:%d: %s", path, line, what);
+        return false;
+    }
+
+    void releaseTextures() {
+        for (ParallaxBackground& background : backgrounds) {
+            for (ParallaxLayer& layer : background.layers) {
+                if (layer.texture != nullptr) SDL_DestroyTexture(layer.texture);
+                layer.texture = nullptr;
+            }
+        }
+        composed.destroy();
+    }
+
+    // Scales the layer's art to its height on screen (nearest neighbor, it's pixel art) and repeats it
+    // until it covers the screen's width.
+    bool prepare(SDL_Renderer* renderer, ParallaxLayer& layer) {
+        if (layer.texture != nullptr) return true;
+        SDL_Surface* art = surfaces[layer.art];
+        int height = std::max(1, static_cast<int>(std::lround(layer.height * screenH)));
+        int tileWidth = std::max(1, static_cast<int>(std::lround(static_cast<double>(art->w) * height / art->h)));
+        int copies = (screenW + tileWidth - 1) / tileWidth;
+        SDL_Surface* scaled = SDL_CreateRGBSurfaceWithFormat(0, copies * tileWidth, height, 32, SDL_PIXELFORMAT_RGBA32);
+        if (scaled == nullptr) {
+            LOG_ERROR("Failed to scale a parallax layer to %dx%d. SDL_Error: %s", copies * tileWidth, height, SDL_GetError());
+            return false;
+        }
+        SDL_SetSurfaceBlendMode(art, SDL_BLENDMODE_NONE); // copy alpha as-is
+        for (int c = 0; c < copies; c++) {
+            SDL_Rect dest = {c * tileWidth, 0, tileWidth, height};
+            SDL_BlitScaled(art, nullptr, scaled, &dest);
+        }
+        layer.texture = SDL_CreateTextureFromSurface(renderer, scaled);
+        layer.width = scaled->w;
+        layer.pixelHeight = height;
+        SDL_FreeSurface(scaled);
+        if (layer.texture == nullptr) {
+            LOG_ERROR("Failed to create a parallax layer texture. SDL_Error: %s", SDL_GetError());
+            return false;
+        }
+        PROFILE_COUNT(PROFILE_TEXTURES_CREATED, 1);
+        SDL_SetTextureBlendMode(layer.texture, SDL_BLENDMODE_BLEND);
+        return true;
+    }
+
+    void drawLayer(SDL_Renderer* renderer, ParallaxLayer& layer, int cameraX, int cameraY) {
+        if (!prepare(renderer, layer)) return;
+        int restTop = static_cast<int>(std::lround(layer.top * screenH));
+        int top = restTop - static_cast<int>(std::lround(static_cast<double>(cameraY) * layer.scroll));
+        if (restTop <= 0) top = std::min(top, 0);
+        if (restTop + layer.pixelHeight >= screenH) top = std::max(top, screenH - layer.pixelHeight);
+        if (top >= screenH || top + layer.pixelHeight <= 0) return;
+
+        // where in the wrapped texture the screen's left edge is
+        long long scrolled = std::llround(static_cast<double>(cameraX) * layer.scroll + time * layer.drift);
+        int start = static_cast<int>(((scrolled % layer.width) + layer.width) % layer.width);
+        int firstWidth = std::min(layer.width - start, screenW);
+        SDL_Rect src = {start, 0, firstWidth, layer.pixelHeight};
+        SDL_Rect dest = {0, top, firstWidth, layer.pixelHeight};
+        renderCopy(renderer, layer.texture, &src, &dest);
+        if (firstWidth < screenW) {
+            src = {0, 0, screenW - firstWidth, layer.pixelHeight};
+            dest = {firstWidth, top, screenW - firstWidth, layer.pixelHeight};
+            renderCopy(renderer, layer.texture, &src, &dest);
+        }
+    }
+
+    std::vector<SDL_Surface*> surfaces; // the art as loaded, kept for scaling again
+    std::unordered_map<std::string, int> artByName;
+    std::vector<ParallaxBackground> backgrounds;
+    std::unordered_map<std::string, int> byName;
+    int current = -1;
+    int screenW = 0; // what the layer textures were scaled for
+    int screenH = 0;
+    int lastX = INT32_MIN; // camera position last frame, in whole pixels
+    int lastY = INT32_MIN;
+    ComposedLayer composed;
+    double time = 0.0;
+};
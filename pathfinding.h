@@ -0,0 +1,234 @@
+#pragma once
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "hex.h"
+#include "hexmap.h"
+#include "terrain.h"
+
+// Pathfinding on the HexMap.
+// https://www.redblobgames.com/pathfinding/a-star/introduction.html
+// Tiles are addressed by map index. A cost function says what it costs to step onto a tile:
+//     int cost(int index)   // movement points, or -1 if the tile can't be entered
+// HexPathfinder keeps its scratch between searches and marks it with a search stamp instead of clearing
+// it, so a query only touches the tiles it actually visits. The scratch is in pages, one per map chunk
+// (hexmap.h), made the first time a search gets into the chunk, so it's as big as the area searched
+// rather than the map, and pages the last search didn't get into are dropped once there are more than
+// PATH_PAGES_KEPT. Use one per thread.
+
+const int PATH_BLOCKED = -1;
+const int PATH_PAGES_KEPT = 64; // 3 MB of scratch
+
+// Movement cost from the terrain + decoration registries. Just references, so it's free to construct per query.
+class TerrainCost {
+public:
+    TerrainCost(const HexMap& map, const TileRegistry& terrain, const TileRegistry& decorations)
+    : map(map), terrain(terrain), decorations(decorations) {}
+
+    int operator()(int index) const {
+        const Tile& tile = map[index];
+        const TileKind& ground = terrain.kind(tile.terrain);
+        const TileKind& decoration = decorations.kind(tile.decoration);
+        if (ground.blocksMove || decoration.blocksMove) return PATH_BLOCKED;
+        return std::max(1, ground.moveCost) + decoration.moveCost;
+    }
+
+private:
+    const HexMap& map;
+    const TileRegistry& terrain;
+    const TileRegistry& decorations;
+};
+
+class HexPathfinder {
+public:
+    // A* from start to goal. Fills path with the tiles to walk through, start excluded and goal included
+    // (empty if start == goal). Returns false if the goal can't be reached, or only for more than maxCost.
+    template <typename Cost>
+    bool findPath(const HexMap& map, int start, int goal, Cost cost, std::vector<int>& path, int maxCost = INT_MAX) {
+        path.clear();
+        if (start < 0 || goal < 0) return false;
+        if (start == goal) return true;
+        beginSearch(map);
+
+        Hex goalHex = map.hexAt(goal);
+        visit(start, 0, -1);
+        open.clear();
+        open.push_back({hex_distance(map.hexAt(start), goalHex), start});
+
+        while (!open.empty()) {
+            std::pop_heap(open.begin(), open.end(), std::greater<std::pair<int, int>>());
+            int current = open.back().second;
+            int f = open.back().first;
+            open.pop_back();
+            // stale heap entry, this tile was reached more cheaply after it was pushed
+            int currentCost = costOf(current);
+            if (f - hex_distance(map.hexAt(current), goalHex) > currentCost) continue;
+            if (current == goal) break;
+
+            for (int d = 0; d < 6; d++) {
+                int next = map.neighbor(current, d);
+                if (next < 0) continue;
+                int step = cost(next);
+                if (step == PATH_BLOCKED) continue;
+                int newCost = currentCost + step;
+                if (newCost > maxCost) continue;
+                const Node* reached = node(next);
+                if (reached == nullptr || newCost < reached->costSoFar) {
+                    visit(next, newCost, current);
+                    // the heuristic assumes every step costs at least 1, which the cost functions guarantee
+                    open.push_back({newCost + hex_distance(map.hexAt(next), goalHex), next});
+                    std::push_heap(open.begin(), open.end(), std::greater<std::pair<int, int>>());
+                }
+            }
+        }
+
+        if (!visited(goal)) return false;
+        for (int at = goal; at != start; at = node(at)->cameFrom) path.push_back(at);
+        std::reverse(path.begin(), path.end());
+        return true;
+    }
+
+    // Every tile reachable from start with at most movePoints (start excluded), nearest first.
+    // It's a breadth first search generalized to small integer step costs with one bucket per
+    // total cost (Dial's algorithm), so it stays linear in the number of tiles in range.
+    // costTo() and pathTo() work for the returned tiles until the next search.
+    template <typename Cost>
+    void movementRange(const HexMap& map, int start, int movePoints, Cost cost, std::vector<int>& reachable) {
+        reachable.clear();
+        if (start < 0 || movePoints <= 0) return;
+        beginSearch(map);
+
+        if (static_cast<int>(buckets.size()) < movePoints + 1) buckets.resize(movePoints + 1);
+        for (int b = 0; b <= movePoints; b++) buckets[b].clear();
+
+        visit(start, 0, -1);
+        buckets[0].push_back(start);
+        for (int b = 0; b <= movePoints; b++) {
+            // buckets[b] can grow while we walk it (zero cost steps), so index instead of iterating
+            for (size_t k = 0; k < buckets[b].size(); k++) {
+                int current = buckets[b][k];
+                if (costOf(current) != b) continue; // found cheaper later
+                if (current != start) reachable.push_back(current);
+                for (int d = 0; d < 6; d++) {
+                    int next = map.neighbor(current, d);
+                    if (next < 0) continue;
+                    int step = cost(next);
+                    if (step == PATH_BLOCKED) continue;
+                    int newCost = b + step;
+                    if (newCost > movePoints) continue;
+                    const Node* reached = node(next);
+                    if (reached == nullptr || newCost < reached->costSoFar) {
+                        visit(next, newCost, current);
+                        buckets[newCost].push_back(next);
+                    }
+                }
+            }
+        }
+    }
+
+    // movement points spent to get to a tile in the last search, -1 if it wasn't reached
+    int costTo(int index) const {
+        return visited(index) ? costOf(index) : -1;
+    }
+
+    // path from the last search's start to a tile it reached, same format as findPath
+    void pathTo(int index, std::vector<int>& path) const {
+        path.clear();
+        if (!visited(index)) return;
+        for (int at = index; node(at)->cameFrom != -1; at = node(at)->cameFrom) path.push_back(at);
+        std::reverse(path.begin(), path.end());
+    }
+
+private:
+    struct Node {
+        uint32_t stamp; // == stamp when the tile was reached in the current search
+        int costSoFar;
+        int cameFrom;
+    };
+    struct Page {
+        Node nodes[MAP_CHUNK_TILES];
+        uint32_t used; // the last search that got into it
+    };
+
+    void beginSearch(const HexMap& map) {
+        if (map.width() != cols || map.size() != tiles) {
+            cols = map.width();
+            tiles = map.size();
+            chunksX = map.chunksWide();
+            pages.clear();
+            pages.resize(map.chunkCount());
+            pagesMade = 0;
+            stamp = 0;
+        }
+        if (pagesMade > PATH_PAGES_KEPT) {
+            for (std::unique_ptr<Page>& page : pages) {
+                if (page && page->used != stamp) {
+                    page.reset();
+                    pagesMade--;
+                }
+            }
+        }
+        stamp++;
+        if (stamp == 0) {
+            // wrapped around after 4 billion searches, old stamps could collide now
+            for (std::unique_ptr<Page>& page : pages) {
+                if (!page) continue;
+                for (Node& n : page->nodes) n.stamp = 0;
+                page->used = 0;
+            }
+            stamp = 1;
+        }
+    }
+
+    // nullptr if the tile wasn't reached in the current search
+    const Node* node(int index) const {
+        if (index < 0 || index >= tiles) return nullptr;
+        int q = index % cols;
+        int row = index / cols;
+        const Page* page = pages[pageOf(q, row)].get();
+        if (page == nullptr) return nullptr;
+        const Node& n = page->nodes[slotOf(q, row)];
+        return n.stamp == stamp ? &n : nullptr;
+    }
+
+    // same math as HexMap's chunks
+    int pageOf(int q, int row) const { return (row >> MAP_CHUNK_SHIFT) * chunksX + (q >> MAP_CHUNK_SHIFT); }
+    static int slotOf(int q, int row) {
+        const int mask = MAP_CHUNK_SIZE - 1;
+        return ((row & mask) << MAP_CHUNK_SHIFT) | (q & mask);
+    }
+
+    bool visited(int index) const { return node(index) != nullptr; }
+
+    // only for tiles the search has visited
+    int costOf(int index) const { return node(index)->costSoFar; }
+
+    void visit(int index, int costToHere, int from) {
+        int q = index % cols;
+        int row = index / cols;
+        std::unique_ptr<Page>& page = pages[pageOf(q, row)];
+        if (!page) {
+            page.reset(new Page());
+            pagesMade++;
+        }
+        page->used = stamp;
+        Node& n = page->nodes[slotOf(q, row)];
+        n.stamp = stamp;
+        n.costSoFar = costToHere;
+        n.cameFrom = from;
+    }
+
+    uint32_t stamp = 0;
+    int cols = 0; // the map's, for finding a tile's page
+    int tiles = 0;
+    int chunksX = 0;
+    std::vector<std::unique_ptr<Page>> pages; // per map chunk, nullptr until a search gets into it
+    int pagesMade = 0;
+    std::vector<std::pair<int, int>> open; // (estimated total cost, index) min-heap
+    std::vector<std::vector<int>> buckets;
+};
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "hex.h"
+#include "hexmap.h"
+
+// Tile marks: per-tile flags for the hovered tile, the selection, move ranges, attack targets and what the player can see.
+// They're a byte per tile in pages of MARK_PAGE_TILES consecutive tiles, so checking a tile is O(1), but
+// only pages with something marked in them exist: marks are around the units and the cursor, not all over
+// a map that can be millions of tiles. Each mark also keeps the list of tiles that have it so clearing a
+// mark doesn't walk the whole map.
+enum TileMark : uint8_t {
+    MARK_HOVER = 1 << 0,
+    MARK_SELECTED = 1 << 1,
+    MARK_MOVE_RANGE = 1 << 2,
+    MARK_ATTACK_TARGET = 1 << 3,
+    MARK_VISIBLE = 1 << 4,      // seen by any of the player's units
+};
+const int TILE_MARK_KINDS = 5;
+const int MARK_PAGE_SHIFT = 12;
+const int MARK_PAGE_TILES = 1 << MARK_PAGE_SHIFT;
+
+class TileMarks {
+public:
+    void resize(int tileCount) {
+        tiles = tileCount;
+        pages.clear();
+        pages.resize((tileCount + MARK_PAGE_TILES - 1) >> MARK_PAGE_SHIFT);
+        for (auto& list : marked) list.clear();
+    }
+
+    bool has(int i, TileMark mark) const { return (get(i) & mark) != 0; }
+
+    uint8_t get(int i) const {
+        if (i < 0 || i >= tiles) return 0;
+        const Page* page = pages[i >> MARK_PAGE_SHIFT].get();
+        return page == nullptr ? 0 : page->marks[i & (MARK_PAGE_TILES - 1)];
+    }
+
+    void set(int i, TileMark mark) {
+        if (i < 0 || i >= tiles || has(i, mark)) return;
+        std::unique_ptr<Page>& page = pages[i >> MARK_PAGE_SHIFT];
+        if (!page) page.reset(new Page());
+        uint8_t& m = page->marks[i & (MARK_PAGE_TILES - 1)];
+        if (m == 0) page->tilesMarked++;
+        m |= mark;
+        marked[bit(mark)].push_back(i);
+    }
+
+    void unset(int i, TileMark mark) {
+        if (!has(i, mark)) return;
+        remove(i, mark);
+        std::vector<int>& list = marked[bit(mark)];
+        for (size_t k = 0; k < list.size(); k++) {
+            if (list[k] == i) {
+                list[k] = list.back();
+                list.pop_back();
+                break;
+            }
+        }
+    }
+
+    // removes a mark from every tile that has it
+    void clear(TileMark mark) {
+        std::vector<int>& list = marked[bit(mark)];
+        for (int i : list) remove(i, mark);
+        list.clear();
+    }
+
+    // every tile that currently has the mark, in the order they were marked
+    const std::vector<int>& tilesWith(TileMark mark) const { return marked[bit(mark)]; }
+
+private:
+    struct Page {
+        uint8_t marks[MARK_PAGE_TILES] = {};
+        int tilesMarked = 0; // the page goes away when this gets back to 0
+    };
+
+    static int bit(TileMark mark) {
+        int b = 0;
+        while ((mark >> b) != 1) b++;
+        return b;
+    }
+
+    // i has the mark
+    void remove(int i, TileMark mark) {
+        std::unique_ptr<Page>& page = pages[i >> MARK_PAGE_SHIFT];
+        uint8_t& m = page->marks[i & (MARK_PAGE_TILES - 1)];
+        m &= ~mark;
+        if (m == 0 && --page->tilesMarked == 0) page.reset();
+    }
+
+    int tiles = 0;
+    std::vector<std::unique_ptr<Page>> pages; // nullptr where nothing is marked
+    std::vector<int> marked[TILE_MARK_KINDS];
+};
+
+// What the cursor is over, resolved in handleInput when the mouse or camera moves and then
+// read by the renderer (and anything else) for the rest of the frame.
+struct Picking {
+    int hovered = -1; // map index of the tile under the cursor, -1 when it's off the map
+    TileMarks marks;
+
+    // spriteOffset is where the tile sprite's center sits relative to its hex_to_pixel anchor
+    void resolve(const HexMap& map, const Layout& screenLayout, int cursorX, int cursorY, Point spriteOffset) {
+        Hex under = hex_round(pixel_to_hex(screenLayout, Point(cursorX - spriteOffset.x, cursorY - spriteOffset.y)));
+        int i = map.index(under);
+        if (i == hovered) return;
+        marks.clear(MARK_HOVER);
+        marks.set(i, MARK_HOVER);
+        hovered = i;
+    }
+
+    void toggleSelected(int i) {
+        if (marks.has(i, MARK_SELECTED)) marks.unset(i, MARK_SELECTED);
+        else marks.set(i, MARK_SELECTED);
+    }
+};
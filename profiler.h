@@ -0,0 +1,212 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+// Frame profiler.
+//   PROFILE_FRAME();                 once at the top of every frame
+//   { PROFILE_ZONE("tiles"); ... }   times the rest of the scope, zones nest
+//   PROFILE_COUNT(PROFILE_DRAW_CALLS, 1);
+// The last PROFILE_FRAME_HISTORY frames are kept in a ring (zones with their start/end and nesting depth,
+// plus the counters), for the in-game overlay and for writeChromeTrace(), which produces a file that
+// chrome://tracing or https://ui.perfetto.dev can open.
+// Zones are for the main thread, counters can be bumped from anywhere.
+//
+// Like the log levels, PROFILE_ENABLED defaults to on in debug builds and off with -DNDEBUG. When it's
+// off every macro compiles to nothing and the profiler types don't exist, so anything that talks to
+// profiler() directly has to sit in #if PROFILE_ENABLED.
+//
+// Allocations are counted by replacing the global operator new. Define PROFILE_DEFINE_ALLOC_HOOK in
+// exactly one .cpp before including this header to get them, otherwise the counter stays at 0.
+
+#ifndef PROFILE_ENABLED
+#ifdef NDEBUG
+#define PROFILE_ENABLED 0
+#else
+#define PROFILE_ENABLED 1
+#endif
+#endif
+
+enum ProfileCounter {
+    PROFILE_DRAW_CALLS,
+    PROFILE_TEXTURES_CREATED,
+    PROFILE_ALLOCATIONS,
+    PROFILE_COUNTER_COUNT
+};
+
+#if PROFILE_ENABLED
+
+const int PROFILE_FRAME_HISTORY = 240;   // four seconds at 60 fps
+const int PROFILE_ZONES_PER_FRAME = 128; // zones past this are dropped (and counted)
+
+// bumped from any thread, read and reset once per frame
+inline std::atomic<uint64_t> profileCounters[PROFILE_COUNTER_COUNT];
+
+struct ProfileZone {
+    const char* name; // string literals only, the pointer is kept
+    int64_t start;    // ns since the profiler started
+    int64_t end;
+    int depth;
+};
+
+struct ProfileFrame {
+    int64_t start = 0;
+    int64_t end = 0;
+    uint64_t counters[PROFILE_COUNTER_COUNT] = {};
+    int zoneCount = 0;
+    int droppedZones = 0;
+    ProfileZone zones[PROFILE_ZONES_PER_FRAME];
+
+    double milliseconds() const { return (end - start) / 1e6; }
+    double zoneMilliseconds(int z) const { return (zones[z].end - zones[z].start) / 1e6; }
+};
+
+class Profiler {
+public:
+    Profiler() : epoch(std::chrono::steady_clock::now()), frames(PROFILE_FRAME_HISTORY) {}
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    // Closes the frame in progress and starts the next one.
+    void beginFrame() {
+        int64_t t = now();
+        if (started) {
+            ProfileFrame& f = frames[current];
+            f.end = t;
+            for (int c = 0; c < PROFILE_COUNTER_COUNT; c++) f.counters[c] = profileCounters[c].exchange(0, std::memory_order_relaxed);
+            current = (current + 1) % PROFILE_FRAME_HISTORY;
+            if (completed < PROFILE_FRAME_HISTORY) completed++;
+        } else {
+            for (int c = 0; c < PROFILE_COUNTER_COUNT; c++) profileCounters[c].store(0, std::memory_order_relaxed);
+            started = true;
+        }
+        ProfileFrame& f = frames[current];
+        f.start = t;
+        f.end = t;
+        f.zoneCount = 0;
+        f.droppedZones = 0;
+        depth = 0;
+    }
+
+    // Returns a token for endZone, -1 if the frame is out of zone slots.
+    int beginZone(const char* name) {
+        ProfileFrame& f = frames[current];
+        depth++;
+        if (f.zoneCount == PROFILE_ZONES_PER_FRAME) {
+            f.droppedZones++;
+            return -1;
+        }
+        int64_t t = now();
+        f.zones[f.zoneCount] = ProfileZone{name, t, t, depth - 1};
+        return f.zoneCount++;
+    }
+
+    void endZone(int token) {
+        depth--;
+        if (token >= 0) frames[current].zones[token].end = now();
+    }
+
+    // completed frames kept, up to PROFILE_FRAME_HISTORY
+    int frameCount() const { return completed; }
+    // 0 is the last completed frame, 1 the one before...
+    const ProfileFrame& frame(int ago) const {
+        return frames[(current - 1 - ago + 2 * PROFILE_FRAME_HISTORY) % PROFILE_FRAME_HISTORY];
+    }
+
+    // Every completed frame in the ring as Chrome trace events: a "frame" span, the zones nested in it
+    // and the counters as counter tracks. Returns false if the file can't be written.
+    bool writeChromeTrace(const char* path) const {
+        FILE* out = fopen(path, "w");
+        if (out == nullptr) return false;
+        static const char* counterNames[PROFILE_COUNTER_COUNT] = {"draw calls", "textures created", "allocations"};
+        fprintf(out, "{\"traceEvents\":[\n");
+        bool first = true;
+        for (int ago = completed - 1; ago >= 0; ago--) {
+            const ProfileFrame& f = frame(ago);
+            fprintf(out, "%s{\"name\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}", first ? "" : ",\n",
+                    f.start / 1e3, (f.end - f.start) / 1e3);
+            first = false;
+            for (int z = 0; z < f.zoneCount; z++) {
+                const ProfileZone& zone = f.zones[z];
+                fprintf(out, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}", zone.name,
+                        zone.start / 1e3, (zone.end - zone.start) / 1e3);
+            }
+            for (int c = 0; c < PROFILE_COUNTER_COUNT; c++) {
+                fprintf(out, ",\n{\"name\":\"%s\",\"ph\":\"C\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"args\":{\"value\":%llu}}",
+                        counterNames[c], f.start / 1e3, static_cast<unsigned long long>(f.counters[c]));
+            }
+        }
+        fprintf(out, "\n],\"displayTimeUnit\":\"ms\"}\n");
+        return fclose(out) == 0;
+    }
+
+private:
+    int64_t now() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    std::chrono::steady_clock::time_point epoch;
+    std::vector<ProfileFrame> frames; // ring, allocated once
+    int current = 0;
+    int completed = 0;
+    int depth = 0;
+    bool started = false;
+};
+
+inline Profiler& profiler() {
+    static Profiler instance;
+    return instance;
+}
+
+class ProfileScope {
+public:
+    explicit ProfileScope(const char* name) : token(profiler().beginZone(name)) {}
+    ~ProfileScope() { profiler().endZone(token); }
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    int token;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_ZONE(name) ProfileScope PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_FRAME() profiler().beginFrame()
+#define PROFILE_COUNT(counter, n) profileCounters[counter].fetch_add(static_cast<uint64_t>(n), std::memory_order_relaxed)
+
+#ifdef PROFILE_DEFINE_ALLOC_HOOK
+// Only counts, the memory still comes from malloc. Nothing in here may allocate.
+void* operator new(std::size_t size) {
+    profileCounters[PROFILE_ALLOCATIONS].fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size == 0 ? 1 : size)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    profileCounters[PROFILE_ALLOCATIONS].fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size == 0 ? 1 : size);
+}
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept {
+    return operator new(size, tag);
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+#endif
+
+#else
+
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_FRAME() ((void)0)
+#define PROFILE_COUNT(counter, n) ((void)0)
+
+#endif
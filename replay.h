@@ -0,0 +1,291 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "log.h"
+
+// Input as a stream of commands, so a session can be recorded and played back.
+// The game turns SDL events into Commands once per frame and only ever acts on the commands, so a
+// replay feeds the same commands back on the same frame numbers and gets the same game: the dice are
+// seeded from the file, and the number of simulation ticks each frame ran is part of the stream.
+// Replays can run in a normal window, offscreen or headless (see main), and FrameTimings turns a run
+// into per-frame numbers (whole frames, and the tile map and fight screen on their own) that can be
+// compared between builds.
+//
+// File layout: the header, then one record per command:
+//   varint   frames since the previous command
+//   byte     CommandType
+//   varint   a, b (zigzag) for the types that carry values
+// A minute of play is a few KB, mostly cursor moves.
+
+const char REPLAY_MAGIC[4] = {'U', 'N', 'G', 'R'};
+const uint32_t REPLAY_VERSION = 2;
+
+enum CommandType : uint8_t {
+    CMD_TICKS,             // a: simulation ticks run this frame, only written when it changes
+    CMD_CURSOR,            // a, b: mouse position in window pixels
+    CMD_CLICK,             // left click at the cursor
+    CMD_PAN,               // a, b: camera pan direction held down, -1..1 on each axis
+    CMD_TOGGLE_FIGHT,      // 'g'
+    CMD_CONFIRM_SHOT,      // enter
+    CMD_END_TURN,          // 'e'
+    CMD_TOGGLE_FULLSCREEN, // escape
+    CMD_TOGGLE_PROFILER,   // F3
+    CMD_WRITE_TRACE,       // F4
+    CMD_QUIT,
+    CMD_UNDO,              // 'u', back to the start of the previous turn
+    CMD_QUICKSAVE,         // F5
+    CMD_QUICKLOAD,         // F9
+    CMD_TYPE_COUNT
+};
+
+inline bool commandHasValues(CommandType type) {
+    return type == CMD_TICKS || type == CMD_CURSOR || type == CMD_PAN;
+}
+
+struct Command {
+    uint32_t frame;
+    CommandType type;
+    int32_t a = 0;
+    int32_t b = 0;
+};
+
+// What the game needs to start up the same way again.
+struct ReplayHeader {
+    uint64_t seed = 0;
+    int32_t tickRate = 60;
+    int32_t generateWidth = 0;
+    int32_t generateHeight = 0;
+    uint8_t bossAi = 0;
+    int32_t aiPlayouts = 0; // AiSettings::playoutsPerOption the enemy turns were planned with (ai.h)
+    std::string mapPath; // empty for a generated map
+};
+
+class ReplayRecorder {
+public:
+    void begin(const ReplayHeader& h) {
+        header = h;
+        bytes.clear();
+        lastFrame = 0;
+        commands = 0;
+    }
+
+    void add(const Command& c) {
+        putVarint(c.frame - lastFrame);
+        lastFrame = c.frame;
+        bytes.push_back(c.type);
+        if (commandHasValues(c.type)) {
+            putVarint(zigzag(c.a));
+            putVarint(zigzag(c.b));
+        }
+        commands++;
+    }
+
+    bool save(const char* path) const {
+        FILE* out = fopen(path, "wb");
+        if (out == nullptr) {
+            LOG_ERROR("Can't write replay %s", path);
+            return false;
+        }
+        uint32_t pathLength = static_cast<uint32_t>(header.mapPath.size());
+        uint32_t count = static_cast<uint32_t>(commands);
+        bool ok = fwrite(REPLAY_MAGIC, 1, 4, out) == 4 && fwrite(&REPLAY_VERSION, 4, 1, out) == 1 &&
+                  fwrite(&header.seed, 8, 1, out) == 1 && fwrite(&header.tickRate, 4, 1, out) == 1 &&
+                  fwrite(&header.generateWidth, 4, 1, out) == 1 && fwrite(&header.generateHeight, 4, 1, out) == 1 &&
+                  fwrite(&header.bossAi, 1, 1, out) == 1 && fwrite(&header.aiPlayouts, 4, 1, out) == 1 &&
+                  fwrite(&pathLength, 4, 1, out) == 1 &&
+                  fwrite(header.mapPath.data(), 1, pathLength, out) == pathLength && fwrite(&count, 4, 1, out) == 1 &&
+                  fwrite(bytes.data(), 1, bytes.size(), out) == bytes.size();
+        ok = fclose(out) == 0 && ok;
+        if (ok) LOG_INFO("Recorded %zu commands over %u frames to %s (%zu bytes)", commands, lastFrame, path, bytes.size());
+        else LOG_ERROR("Failed writing replay %s", path);
+        return ok;
+    }
+
+private:
+    static uint32_t zigzag(int32_t v) { return (static_cast<uint32_t>(v) << 1) ^ static_cast<uint32_t>(v >> 31); }
+
+    void putVarint(uint32_t v) {
+        while (v >= 0x80) {
+            bytes.push_back(static_cast<uint8_t>(v | 0x80));
+            v >>= 7;
+        }
+        bytes.push_back(static_cast<uint8_t>(v));
+    }
+
+    ReplayHeader header;
+    std::vector<uint8_t> bytes;
+    uint32_t lastFrame = 0;
+    size_t commands = 0;
+};
+
+class ReplayPlayer {
+public:
+    bool load(const char* path) {
+        FILE* in = fopen(path, "rb");
+        if (in == nullptr) {
+            LOG_ERROR("Can't open replay %s", path);
+            return false;
+        }
+        std::vector<uint8_t> bytes;
+        uint8_t buffer[4096];
+        size_t n;
+        while ((n = fread(buffer, 1, sizeof(buffer), in)) > 0) bytes.insert(bytes.end(), buffer, buffer + n);
+        fclose(in);
+
+        size_t at = 0;
+        auto read = [&](void* dst, size_t size) {
+            if (at + size > bytes.size()) return false;
+            std::copy(bytes.begin() + at, bytes.begin() + at + size, static_cast<uint8_t*>(dst));
+            at += size;
+            return true;
+        };
+        char magic[4];
+        uint32_t version = 0;
+        uint32_t pathLength = 0;
+        uint32_t count = 0;
+        if (!read(magic, 4) || !std::equal(magic, magic + 4, REPLAY_MAGIC) || !read(&version, 4) || version != REPLAY_VERSION) {
+            LOG_ERROR("%s isn't a version %u replay", path, REPLAY_VERSION);
+            return false;
+        }
+        if (!read(&header.seed, 8) || !read(&header.tickRate, 4) || !read(&header.generateWidth, 4) ||
+            !read(&header.generateHeight, 4) || !read(&header.bossAi, 1) || !read(&header.aiPlayouts, 4) || !read(&pathLength, 4) ||
+            pathLength > 4096) {
+            LOG_ERROR("%s: truncated header", path);
+            return false;
+        }
+        header.mapPath.resize(pathLength);
+        if (!read(&header.mapPath[0], pathLength) || !read(&count, 4)) {
+            LOG_ERROR("%s: truncated header", path);
+            return false;
+        }
+
+        commands.clear();
+        commands.reserve(count);
+        uint32_t frame = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t delta, a = 0, b = 0;
+            if (!getVarint(bytes, at, delta) || at >= bytes.size() || bytes[at] >= CMD_TYPE_COUNT) {
+                LOG_ERROR("%s: broken command %u", path, i);
+                return false;
+            }
+            CommandType type = static_cast<CommandType>(bytes[at++]);
+            if (commandHasValues(type) && (!getVarint(bytes, at, a) || !getVarint(bytes, at, b))) {
+                LOG_ERROR("%s: broken command %u", path, i);
+                return false;
+            }
+            frame += delta;
+            commands.push_back(Command{frame, type, unzigzag(a), unzigzag(b)});
+        }
+        next = 0;
+        return true;
+    }
+
+    const ReplayHeader& info() const { return header; }
+
+    // Appends the commands recorded for frame (frames have to be asked for in order).
+    void take(uint32_t frame, std::vector<Command>& out) {
+        while (next < commands.size() && commands[next].frame <= frame) out.push_back(commands[next++]);
+    }
+
+    bool finished() const { return next >= commands.size(); }
+    uint32_t lastFrame() const { return commands.empty() ? 0 : commands.back().frame; }
+
+private:
+    static int32_t unzigzag(uint32_t v) { return static_cast<int32_t>(v >> 1) ^ -static_cast<int32_t>(v & 1); }
+
+    static bool getVarint(const std::vector<uint8_t>& bytes, size_t& at, uint32_t& v) {
+        v = 0;
+        for (int shift = 0; shift < 35; shift += 7) {
+            if (at >= bytes.size()) return false;
+            uint8_t byte = bytes[at++];
+            v |= static_cast<uint32_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) return true;
+        }
+        return false;
+    }
+
+    ReplayHeader header;
+    std::vector<Command> commands;
+    size_t next = 0;
+};
+
+// One series of timings from a run (the frame's work, or one function's share of it), with the usual
+// summary numbers. Frame times don't include the frame cap's sleep.
+class FrameTimings {
+public:
+    explicit FrameTimings(const char* name) : name(name) {}
+
+    void add(double ms) { samples.push_back(static_cast<float>(ms)); }
+    size_t count() const { return samples.size(); }
+    const char* label() const { return name; }
+
+    // p in 0..100, nearest rank
+    double percentile(double p) const {
+        if (samples.empty()) return 0.0;
+        std::vector<float> sorted(samples);
+        size_t rank = static_cast<size_t>(p / 100.0 * (sorted.size() - 1) + 0.5);
+        std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+        return sorted[rank];
+    }
+
+    double mean() const {
+        double total = 0.0;
+        for (float f : samples) total += f;
+        return samples.empty() ? 0.0 : total / samples.size();
+    }
+
+    void logSummary() const {
+        LOG_INFO("%s: %zu samples, mean %.3f ms, p50 %.3f, p95 %.3f, p99 %.3f, max %.3f", name, samples.size(), mean(),
+                 percentile(50), percentile(95), percentile(99), percentile(100));
+    }
+
+    // {"name":{"count":..,"mean_ms":..,...,"ms":[every sample]}}, without the braces around it
+    void writeJson(FILE* out) const {
+        fprintf(out, "\"%s\":{\"count\":%zu,\"mean_ms\":%.4f,\"p50_ms\":%.4f,\"p95_ms\":%.4f,\"p99_ms\":%.4f,\"max_ms\":%.4f,\"ms\":[",
+                name, samples.size(), mean(), percentile(50), percentile(95), percentile(99), percentile(100));
+        for (size_t i = 0; i < samples.size(); i++) fprintf(out, "%s%.4f", i ? "," : "", samples[i]);
+        fprintf(out, "]}");
+    }
+
+private:
+    const char* name;
+    std::vector<float> samples;
+};
+
+// Adds the time until the end of the scope to timings, if there are any (nothing is timed outside replays).
+class ScopedTiming {
+public:
+    explicit ScopedTiming(FrameTimings* timings) : timings(timings) {
+        if (timings != nullptr) start = std::chrono::steady_clock::now();
+    }
+    ~ScopedTiming() {
+        if (timings != nullptr) timings->add(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    ScopedTiming(const ScopedTiming&) = delete;
+    ScopedTiming& operator=(const ScopedTiming&) = delete;
+
+private:
+    FrameTimings* timings;
+    std::chrono::steady_clock::time_point start;
+};
+
+// Every series in one JSON object, for comparing runs in CI.
+inline bool writeTimingReport(const char* path, const std::vector<const FrameTimings*>& series) {
+    FILE* out = fopen(path, "w");
+    if (out == nullptr) {
+        LOG_ERROR("Can't write %s", path);
+        return false;
+    }
+    fprintf(out, "{");
+    for (size_t i = 0; i < series.size(); i++) {
+        if (i > 0) fprintf(out, ",\n");
+        series[i]->writeJson(out);
+    }
+    fprintf(out, "}\n");
+    return fclose(out) == 0;
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstdint>
+
+// Random numbers for the game.
+// Pcg32 is the PCG-XSH-RR generator (https://www.pcg-random.org): 16 bytes of state, a multiply and a
+// few shifts per number, and a stream selector so differently numbered streams from the same seed never
+// overlap. Dice keeps one stream per purpose so rolling for cosmetics (text colors, idle variations)
+// can never shift which numbers combat gets, and the whole thing is seeded from one number and can be
+// saved and restored, which is what replays and lockstep multiplayer need.
+// Everything is integer math, nothing goes through floating point unless you ask for unit().
+
+class Pcg32 {
+public:
+    struct State {
+        uint64_t state;
+        uint64_t inc;
+    };
+
+    Pcg32() { seed(0, 0); }
+    Pcg32(uint64_t seedValue, uint64_t stream) { seed(seedValue, stream); }
+
+    void seed(uint64_t seedValue, uint64_t stream) {
+        state = 0;
+        inc = (stream << 1) | 1;
+        next();
+        state += seedValue;
+        next();
+    }
+
+    uint32_t next() {
+        uint64_t old = state;
+        state = old * 6364136223846793005ULL + inc;
+        uint32_t xorshifted = static_cast<uint32_t>(((old >> 18) ^ old) >> 27);
+        uint32_t rot = static_cast<uint32_t>(old >> 59);
+        return (xorshifted >> rot) | (xorshifted << ((32 - rot) & 31));
+    }
+
+    // Uniform in [0, bound) without modulo bias, Lemire's multiply-and-reject.
+    // Almost always one multiply, the loop only runs again for a tiny fraction of values.
+    uint32_t below(uint32_t bound) {
+        uint64_t m = static_cast<uint64_t>(next()) * bound;
+        uint32_t low = static_cast<uint32_t>(m);
+        if (low < bound) {
+            uint32_t threshold = (0u - bound) % bound;
+            while (low < threshold) {
+                m = static_cast<uint64_t>(next()) * bound;
+                low = static_cast<uint32_t>(m);
+            }
+        }
+        return static_cast<uint32_t>(m >> 32);
+    }
+
+    // uniform in [lo, hi], both included
+    int range(int lo, int hi) {
+        return lo + static_cast<int>(below(static_cast<uint32_t>(hi - lo) + 1));
+    }
+
+    // count dice with sides faces each, summed (3d6 is roll(3, 6))
+    int roll(int count, int sides) {
+        int total = 0;
+        for (int i = 0; i < count; i++) total += 1 + static_cast<int>(below(static_cast<uint32_t>(sides)));
+        return total;
+    }
+
+    // true with chance percent probability
+    bool percent(int chance) {
+        return static_cast<int>(below(100)) < chance;
+    }
+
+    // [0, 1), for cosmetic stuff where a float is what you want anyway
+    float unit() {
+        return (next() >> 8) * (1.0f / 16777216.0f);
+    }
+
+    State save() const { return State{state, inc}; }
+    void restore(const State& s) {
+        state = s.state;
+        inc = s.inc;
+    }
+
+private:
+    uint64_t state;
+    uint64_t inc; // always odd, picks the stream
+};
+
+enum RngStream {
+    RNG_COMBAT,    // hit chances, attack resolution, anything that decides the game
+    RNG_MAPGEN,    // map generation and decoration
+    RNG_COSMETIC,  // visuals only, free to use per frame
+    RNG_STREAM_COUNT
+};
+
+class Dice {
+public:
+    struct State {
+        uint64_t seed;
+        Pcg32::State streams[RNG_STREAM_COUNT];
+    };
+
+    explicit Dice(uint64_t seedValue = 0) { seed(seedValue); }
+
+    void seed(uint64_t seedValue) {
+        seedUsed = seedValue;
+        for (int i = 0; i < RNG_STREAM_COUNT; i++) streams[i].seed(seedValue, static_cast<uint64_t>(i));
+    }
+
+    uint64_t seedValue() const { return seedUsed; }
+
+    Pcg32& stream(RngStream s) { return streams[s]; }
+    Pcg32& combat() { return streams[RNG_COMBAT]; }
+    Pcg32& mapgen() { return streams[RNG_MAPGEN]; }
+    Pcg32& cosmetic() { return streams[RNG_COSMETIC]; }
+
+    State save() const {
+        State s;
+        s.seed = seedUsed;
+        for (int i = 0; i < RNG_STREAM_COUNT; i++) s.streams[i] = streams[i].save();
+        return s;
+    }
+
+    void restore(const State& s) {
+        seedUsed = s.seed;
+        for (int i = 0; i < RNG_STREAM_COUNT; i++) streams[i].restore(s.streams[i]);
+    }
+
+private:
+    uint64_t seedUsed;
+    Pcg32 streams[RNG_STREAM_COUNT];
+};
@@ -0,0 +1,496 @@
+#pragma once
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "hexmap.h"
+#include "entities.h"
+#include "terrain.h"
+#include "rng.h"
+#include "snapshot.h"
+#include "log.h"
+
+// Saved games.
+// A save is a GameSnapshot (snapshot.h) written out: the map's chunks the same way map files store them
+// (mapfile.h), so loading one is an mmap and the map sits right on the file, nothing is read until a
+// chunk is looked at. The units and the rest are small and copied in.
+// Saves are written from a snapshot, which never changes, so SaveWriter does it on a thread of its own
+// and the game doesn't wait on the disk. Saving to the same file again appends only the chunks that changed
+// (see writeSave), so an autosave a turn costs about what the turn changed, not the map's size.
+// UndoHistory keeps the last few turns' snapshots, which share everything that didn't change between them.
+//
+// Layout (little endian, offsets from the start of the file):
+//   SaveHeader
+//   tiles       from SAVE_ALIGN, chunks of MAP_CHUNK_TILES Tiles, each page aligned. Saves appended to
+//               leave the chunks they replaced behind, the chunk table says which are the map
+//   names       at namesOffset, terrain names then decoration names, each '\0' terminated, in id order
+//   units       unitCount each of tile, health, movePoints, idOf (int32/uint32 arrays), then unitClass, team (bytes)
+//   sparse      idCount denseOf (int32), idCount generations, freeCount freeIds (uint32)
+//   session     SaveSession
+//   chunk table chunksX * chunksY uint64 offsets of the chunks, row by row, ends at fileSize
+// Bump SAVE_VERSION whenever any of this changes (SaveSession included), old saves are refused rather than misread.
+
+const char SAVE_MAGIC[4] = {'U', 'N', 'G', 'S'};
+const uint32_t SAVE_VERSION = 2;
+const uint64_t SAVE_ALIGN = 4096;
+
+struct SaveHeader {
+    char magic[4];
+    uint32_t version;
+    int32_t width;
+    int32_t height;
+    uint32_t chunkSize;
+    uint32_t chunksX;
+    uint32_t chunksY;
+    uint32_t terrainCount;
+    uint32_t decorationCount;
+    uint32_t unitCount;
+    uint32_t idCount;
+    uint32_t freeCount;
+    uint64_t namesOffset;
+    uint64_t unitsOffset;
+    uint64_t sparseOffset;
+    uint64_t sessionOffset;
+    uint64_t chunkTableOffset;
+    uint64_t fileSize;
+};
+
+// Everything about a game that isn't the map or the units, written as is.
+struct SaveSession {
+    uint32_t turn = 0;
+    int32_t shotState = 0;
+    int32_t shotChance = 0;
+    uint8_t mapMode = 1;
+    uint8_t padding[3] = {};
+    EntityHandle playerOne;
+    EntityHandle shotTarget;
+    double cameraX = 0;
+    double cameraY = 0;
+    Dice::State dice = {};
+};
+
+struct GameSnapshot {
+    MapSnapshot map;
+    EntitySnapshot units;
+    SaveSession session;
+};
+
+// previous, if there is one, is the last snapshot of the same game: whatever didn't change since is shared with it.
+inline GameSnapshot takeSnapshot(HexMap& map, const EntityStore& units, const SaveSession& session,
+                                 const GameSnapshot* previous = nullptr, SnapshotStats* stats = nullptr) {
+    GameSnapshot s;
+    s.map = snapshotMap(map, previous ? &previous->map : nullptr, stats);
+    s.units = snapshotUnits(units, previous ? &previous->units : nullptr, stats);
+    s.session = session;
+    return s;
+}
+
+inline std::vector<std::string> kindNames(const TileRegistry& registry) {
+    std::vector<std::string> names;
+    for (int i = 0; i < registry.size(); i++) names.push_back(registry.name(static_cast<TileKindId>(i)));
+    return names;
+}
+
+// What a save file this process wrote holds, so the next save to the same file only appends the chunks
+// that changed (see writeSave). Only whoever writes the file should touch it.
+struct SaveFileState {
+    MapSnapshot map;                    // the chunks as they are in the file
+    std::vector<uint64_t> chunkOffsets; // where each of them is
+    std::vector<std::string> terrainNames;
+    std::vector<std::string> decorationNames;
+    uint64_t end = 0;           // the file's size, 0 until it's been written in full once
+    uint64_t appendedBytes = 0; // chunk bytes appended since then
+};
+
+// Writes a save. Without a state, or the first time with one, the whole file is written to path + ".tmp"
+// and renamed over path when it's complete. After that, saves to the same path append only the chunks that
+// aren't in the file yet (snapshots share unchanged chunks, so that's a pointer compare per chunk) and a new
+// copy of the small stuff, and then point the header at it. Nothing that's already in the file is
+// overwritten but the header, so a crash halfway through leaves the last good save. Once the appended
+// chunks add up to the map's size the file is written in full again, which drops the stale ones.
+// Doesn't touch anything but its arguments, any thread can call it. chunksWritten is for the log.
+inline bool writeSave(const std::string& path, const GameSnapshot& snapshot, const std::vector<std::string>& terrainNames,
+                      const std::vector<std::string>& decorationNames, SaveFileState* state = nullptr, int* chunksWritten = nullptr) {
+    const uint64_t chunkBytes = MAP_CHUNK_TILES * sizeof(Tile);
+    std::string names;
+    for (const std::string& n : terrainNames) names += n + '\0';
+    for (const std::string& n : decorationNames) names += n + '\0';
+    const EntitySnapshot& units = snapshot.units;
+    EntityStore::Sparse noSparse;
+    const EntityStore::Sparse& sparse = units.sparse ? *units.sparse : noSparse;
+    const std::vector<std::shared_ptr<const Tile>>& chunks = snapshot.map.chunks;
+
+    SaveHeader header;
+    memcpy(header.magic, SAVE_MAGIC, sizeof(header.magic));
+    header.version = SAVE_VERSION;
+    header.width = snapshot.map.width;
+    header.height = snapshot.map.height;
+    header.chunkSize = MAP_CHUNK_SIZE;
+    header.chunksX = static_cast<uint32_t>((snapshot.map.width + MAP_CHUNK_SIZE - 1) >> MAP_CHUNK_SHIFT);
+    header.chunksY = static_cast<uint32_t>((snapshot.map.height + MAP_CHUNK_SIZE - 1) >> MAP_CHUNK_SHIFT);
+    header.terrainCount = static_cast<uint32_t>(terrainNames.size());
+    header.decorationCount = static_cast<uint32_t>(decorationNames.size());
+    header.unitCount = static_cast<uint32_t>(units.count);
+    header.idCount = static_cast<uint32_t>(sparse.denseOf.size());
+    header.freeCount = static_cast<uint32_t>(sparse.freeIds.size());
+    if (chunks.size() != static_cast<size_t>(header.chunksX) * header.chunksY) {
+        LOG_ERROR("Snapshot for %s has %zu chunks, expected %u", path.c_str(), chunks.size(), header.chunksX * header.chunksY);
+        return false;
+    }
+
+    bool append = state != nullptr && state->end > 0 && state->map.width == snapshot.map.width
+                  && state->map.height == snapshot.map.height && state->terrainNames == terrainNames
+                  && state->decorationNames == decorationNames && state->appendedBytes < chunks.size() * chunkBytes;
+    std::string target = append ? path : path + ".tmp";
+    FILE* file = fopen(target.c_str(), append ? "r+b" : "wb");
+    if (file == nullptr) {
+        LOG_ERROR("Can't write save %s", target.c_str());
+        return false;
+    }
+
+    // chunks first, each page aligned so a loaded save's chunks can be paged like a map file's
+    std::vector<uint64_t> offsets = append ? state->chunkOffsets : std::vector<uint64_t>(chunks.size());
+    uint64_t at = append ? (state->end + SAVE_ALIGN - 1) / SAVE_ALIGN * SAVE_ALIGN : SAVE_ALIGN;
+    uint64_t appended = 0;
+    bool ok = true;
+    for (size_t c = 0; ok && c < chunks.size(); c++) {
+        if (append && chunks[c] == state->map.chunks[c]) continue;
+        ok = fseeko(file, static_cast<off_t>(at), SEEK_SET) == 0 &&
+             fwrite(chunks[c].get(), sizeof(Tile), MAP_CHUNK_TILES, file) == static_cast<size_t>(MAP_CHUNK_TILES);
+        offsets[c] = at;
+        at += chunkBytes;
+        appended += chunkBytes;
+    }
+
+    // then everything else in one block, the chunk table last
+    header.namesOffset = at;
+    header.unitsOffset = header.namesOffset + names.size();
+    header.sparseOffset = header.unitsOffset + static_cast<uint64_t>(header.unitCount) * (4 * 4 + 2);
+    header.sessionOffset = header.sparseOffset + (static_cast<uint64_t>(header.idCount) * 2 + header.freeCount) * 4;
+    header.chunkTableOffset = header.sessionOffset + sizeof(SaveSession);
+    header.fileSize = header.chunkTableOffset + chunks.size() * sizeof(uint64_t);
+    std::vector<char> block;
+    block.reserve(header.fileSize - header.namesOffset);
+    auto put = [&](const void* data, size_t size) {
+        const char* bytes = static_cast<const char*>(data);
+        block.insert(block.end(), bytes, bytes + size);
+    };
+    put(names.data(), names.size());
+    // the units go out one component at a time, page by page
+    auto component = [&](auto member) {
+        for (const auto& page : units.pages) {
+            const auto* values = &((*page).*member)[0];
+            put(values, page->count * sizeof(values[0]));
+        }
+    };
+    component(&EntityPage::tile);
+    component(&EntityPage::health);
+    component(&EntityPage::movePoints);
+    component(&EntityPage::idOf);
+    component(&EntityPage::unitClass);
+    component(&EntityPage::team);
+    put(sparse.denseOf.data(), sparse.denseOf.size() * 4);
+    put(sparse.generations.data(), sparse.generations.size() * 4);
+    put(sparse.freeIds.data(), sparse.freeIds.size() * 4);
+    put(&snapshot.session, sizeof(SaveSession));
+    put(offsets.data(), offsets.size() * sizeof(uint64_t));
+    ok = ok && fseeko(file, static_cast<off_t>(header.namesOffset), SEEK_SET) == 0 &&
+         fwrite(block.data(), 1, block.size(), file) == block.size();
+
+    // everything the header points at has to be on disk before the header is
+    ok = ok && fflush(file) == 0 && fsync(fileno(file)) == 0;
+    ok = ok && fseeko(file, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, file) == 1;
+    ok = (fclose(file) == 0) && ok;
+    if (!append) ok = ok && std::rename(target.c_str(), path.c_str()) == 0;
+    if (!ok) {
+        LOG_ERROR("Failed writing save %s", path.c_str());
+        if (!append) std::remove(target.c_str());
+        if (state != nullptr) *state = SaveFileState(); // not sure what's in the file now, write it in full next time
+        return false;
+    }
+    if (state != nullptr) {
+        state->map = snapshot.map;
+        state->chunkOffsets = std::move(offsets);
+        state->terrainNames = terrainNames;
+        state->decorationNames = decorationNames;
+        state->end = header.fileSize;
+        state->appendedBytes = append ? state->appendedBytes + appended : 0;
+    }
+    if (chunksWritten != nullptr) *chunksWritten = static_cast<int>(appended / chunkBytes);
+    return true;
+}
+
+// Maps a save and fills in snapshot with the map's chunks pointing into the file. The kind names in the
+// save have to be the ones the game registered (same build, same --map), ids are stored, not names.
+inline bool loadSave(const char* path, const std::vector<std::string>& terrainNames, const std::vector<std::string>& decorationNames,
+                     GameSnapshot& snapshot) {
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        LOG_ERROR("Can't open save %s", path);
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(SaveHeader)) {
+        LOG_ERROR("Save %s is too small to be a save", path);
+        ::close(fd);
+        return false;
+    }
+    size_t length = static_cast<size_t>(info.st_size);
+    // the map never writes to borrowed chunks (hexmap.h), read only is enough
+    void* base = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        LOG_ERROR("Can't map save %s", path);
+        return false;
+    }
+    std::shared_ptr<void> mapping(base, [length](void* p) { munmap(p, length); });
+    const char* bytes = static_cast<const char*>(base);
+
+    SaveHeader header;
+    memcpy(&header, bytes, sizeof(header));
+    if (memcmp(header.magic, SAVE_MAGIC, sizeof(header.magic)) != 0 || header.version != SAVE_VERSION) {
+        LOG_ERROR("%s isn't a version %u save", path, SAVE_VERSION);
+        return false;
+    }
+    // a file can be longer than its header says, an append that never got to its header
+    const uint64_t chunkBytes = MAP_CHUNK_TILES * sizeof(Tile);
+    uint64_t chunkCount = static_cast<uint64_t>(header.chunksX) * header.chunksY;
+    if (header.chunkSize != MAP_CHUNK_SIZE || header.width <= 0 || header.height <= 0
+        || header.chunksX != static_cast<uint32_t>((header.width + MAP_CHUNK_SIZE - 1) >> MAP_CHUNK_SHIFT)
+        || header.chunksY != static_cast<uint32_t>((header.height + MAP_CHUNK_SIZE - 1) >> MAP_CHUNK_SHIFT)
+        || static_cast<int64_t>(header.width) * header.height > INT32_MAX
+        || header.terrainCount > TILE_KIND_LIMIT || header.decorationCount > TILE_KIND_LIMIT
+        || header.fileSize > length || header.namesOffset < sizeof(SaveHeader) || header.namesOffset > header.fileSize
+        || header.unitsOffset < header.namesOffset || header.unitsOffset > header.fileSize
+        || header.unitsOffset + static_cast<uint64_t>(header.unitCount) * (4 * 4 + 2) != header.sparseOffset
+        || header.sparseOffset + (static_cast<uint64_t>(header.idCount) * 2 + header.freeCount) * 4 != header.sessionOffset
+        || header.sessionOffset + sizeof(SaveSession) != header.chunkTableOffset
+        || header.chunkTableOffset + chunkCount * sizeof(uint64_t) != header.fileSize) {
+        LOG_ERROR("Save %s is corrupt or was written with a different chunk size", path);
+        return false;
+    }
+    std::vector<uint64_t> offsets(chunkCount);
+    memcpy(offsets.data(), bytes + header.chunkTableOffset, chunkCount * sizeof(uint64_t));
+    for (uint64_t offset : offsets) {
+        if (offset % SAVE_ALIGN != 0 || offset < SAVE_ALIGN || offset > header.namesOffset || header.namesOffset - offset < chunkBytes) {
+            LOG_ERROR("Save %s has a broken chunk table", path);
+            return false;
+        }
+    }
+
+    // kind ids have to mean the same thing they did when it was saved
+    const char* name = bytes + header.namesOffset;
+    const char* namesEnd = bytes + header.unitsOffset;
+    for (uint32_t i = 0; i < header.terrainCount + header.decorationCount; i++) {
+        size_t n = strnlen(name, namesEnd - name);
+        const std::vector<std::string>& expected = i < header.terrainCount ? terrainNames : decorationNames;
+        uint32_t k = i < header.terrainCount ? i : i - header.terrainCount;
+        if (name + n >= namesEnd) {
+            LOG_ERROR("Save %s has a broken name table", path);
+            return false;
+        }
+        if (k >= expected.size() || expected[k].compare(0, std::string::npos, name, n) != 0) {
+            LOG_ERROR("Save %s has kind '%.*s' where the game has '%s', was it saved on a different map?", path, static_cast<int>(n),
+                      name, k < expected.size() ? expected[k].c_str() : "nothing");
+            return false;
+        }
+        name += n + 1;
+    }
+
+    // every tile's kinds have to be in the name tables. This reads the whole map, a save is a game's map and
+    // not one of the huge streamed ones
+    GameSnapshot s;
+    s.map.width = header.width;
+    s.map.height = header.height;
+    s.map.chunks.resize(chunkCount);
+    TileKindId maxTerrain = 0;
+    TileKindId maxDecoration = 0;
+    for (uint64_t c = 0; c < chunkCount; c++) {
+        const Tile* tiles = reinterpret_cast<const Tile*>(bytes + offsets[c]);
+        for (int i = 0; i < MAP_CHUNK_TILES; i++) {
+            maxTerrain = std::max(maxTerrain, tiles[i].terrain);
+            maxDecoration = std::max(maxDecoration, tiles[i].decoration);
+        }
+        s.map.chunks[c] = std::shared_ptr<const Tile>(mapping, tiles);
+    }
+    if (maxTerrain >= header.terrainCount || maxDecoration >= header.decorationCount) {
+        LOG_ERROR("Save %s has tiles of kinds it doesn't name", path);
+        return false;
+    }
+
+    uint32_t unitCount = header.unitCount;
+    std::vector<std::shared_ptr<EntityPage>> pages;
+    for (uint32_t first = 0; first < unitCount; first += ENTITY_PAGE_UNITS) {
+        pages.emplace_back(new EntityPage());
+        pages.back()->count = static_cast<int32_t>(std::min<uint32_t>(ENTITY_PAGE_UNITS, unitCount - first));
+    }
+    const char* at = bytes + header.unitsOffset;
+    auto component = [&](auto member) {
+        for (const auto& page : pages) {
+            auto* values = &((*page).*member)[0];
+            memcpy(values, at, page->count * sizeof(values[0]));
+            at += page->count * sizeof(values[0]);
+        }
+    };
+    component(&EntityPage::tile);
+    component(&EntityPage::health);
+    component(&EntityPage::movePoints);
+    component(&EntityPage::idOf);
+    component(&EntityPage::unitClass);
+    component(&EntityPage::team);
+    s.units.count = static_cast<int>(unitCount);
+    s.units.pages.assign(pages.begin(), pages.end());
+
+    auto sparse = std::make_shared<EntityStore::Sparse>();
+    sparse->denseOf.resize(header.idCount);
+    sparse->generations.resize(header.idCount);
+    sparse->freeIds.resize(header.freeCount);
+    at = bytes + header.sparseOffset;
+    // empty vectors' data() can be null, memcpy doesn't take that even for 0 bytes
+    if (header.idCount > 0) {
+        memcpy(sparse->denseOf.data(), at, header.idCount * 4u);
+        memcpy(sparse->generations.data(), at + header.idCount * 4u, header.idCount * 4u);
+    }
+    if (header.freeCount > 0) memcpy(sparse->freeIds.data(), at + header.idCount * 8u, header.freeCount * 4u);
+
+    // a broken file shouldn't be able to send the store off the end of its arrays, or leave handles and
+    // slots pointing at each other wrong: every unit's id has to point back at it, every other id is free
+    auto broken = [&]() {
+        LOG_ERROR("Save %s has a broken unit table", path);
+        return false;
+    };
+    uint32_t liveIds = 0;
+    for (uint32_t i = 0; i < header.idCount; i++) {
+        if (sparse->denseOf[i] == NO_ENTITY) continue;
+        if (sparse->denseOf[i] < 0 || sparse->denseOf[i] >= static_cast<int>(unitCount)) return broken();
+        liveIds++;
+    }
+    if (liveIds != unitCount) return broken();
+    for (uint32_t id : sparse->freeIds) {
+        if (id >= header.idCount || sparse->denseOf[id] != NO_ENTITY) return broken();
+    }
+    int tileCount = header.width * header.height;
+    for (size_t p = 0; p < s.units.pages.size(); p++) {
+        const EntityPage& page = *s.units.pages[p];
+        for (int k = 0; k < page.count; k++) {
+            int slot = static_cast<int>(p) * ENTITY_PAGE_UNITS + k;
+            if (page.idOf[k] >= header.idCount || sparse->denseOf[page.idOf[k]] != slot || page.unitClass[k] >= CLASS_COUNT
+                || page.team[k] > TEAM_ENEMY || page.tile[k] < 0 || page.tile[k] >= tileCount) {
+                return broken();
+            }
+        }
+    }
+    s.units.sparse = sparse;
+    memcpy(&s.session, bytes + header.sessionOffset, sizeof(SaveSession));
+    if (s.session.shotState < 0 || s.session.shotState > 2) {
+        LOG_ERROR("Save %s has a broken session", path);
+        return false;
+    }
+    snapshot = std::move(s);
+    LOG_INFO("Mapped save %s: %dx%d tiles, %u units, turn %u", path, header.width, header.height, unitCount, snapshot.session.turn);
+    return true;
+}
+
+// Writes saves in the background, on a thread of its own. save() never waits: each file has one pending
+// save, and a newer one for the same file replaces it, only the latest state of a game is worth writing.
+class SaveWriter {
+public:
+    SaveWriter() = default;
+    SaveWriter(const SaveWriter&) = delete;
+    SaveWriter& operator=(const SaveWriter&) = delete;
+    ~SaveWriter() { finish(); }
+
+    void save(std::string path, GameSnapshot snapshot, std::vector<std::string> terrainNames, std::vector<std::string> decorationNames) {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending[path] = Job{std::move(snapshot), std::move(terrainNames), std::move(decorationNames)};
+        if (!writer.joinable()) writer = std::thread([this] { run(); });
+        wake.notify_one();
+    }
+
+    // Writes what's pending and stops the thread. Blocks on the disk, for shutting down only.
+    void finish() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+            wake.notify_one();
+        }
+        if (writer.joinable()) writer.join();
+        stopping = false;
+    }
+
+private:
+    struct Job {
+        GameSnapshot snapshot;
+        std::vector<std::string> terrainNames;
+        std::vector<std::string> decorationNames;
+    };
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            wake.wait(lock, [this] { return stopping || !pending.empty(); });
+            if (pending.empty()) return; // stopping, and nothing left to write
+            std::string path = pending.begin()->first;
+            Job job = std::move(pending.begin()->second);
+            pending.erase(pending.begin());
+            lock.unlock();
+            auto start = std::chrono::steady_clock::now();
+            int chunks = 0;
+            if (writeSave(path, job.snapshot, job.terrainNames, job.decorationNames, &files[path], &chunks)) {
+                double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                LOG_INFO("Saved turn %u to %s in %.1f ms, %d of %zu chunks written", job.snapshot.session.turn, path.c_str(), ms,
+                         chunks, job.snapshot.map.chunks.size());
+            }
+            lock.lock();
+        }
+    }
+
+    std::thread writer;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::map<std::string, Job> pending; // by path
+    bool stopping = false;
+    std::map<std::string, SaveFileState> files; // the writer thread's own
+};
+
+// The last few turns' snapshots, newest last. They share whatever didn't change between them.
+class UndoHistory {
+public:
+    explicit UndoHistory(size_t depth = 16) : depth(depth) {}
+
+    void push(GameSnapshot snapshot) {
+        snapshots.push_back(std::move(snapshot));
+        if (snapshots.size() > depth) snapshots.pop_front();
+    }
+
+    // nullptr when empty
+    const GameSnapshot* latest() const { return snapshots.empty() ? nullptr : &snapshots.back(); }
+
+    // Drops the newest snapshot and returns the one before it, nullptr if there's nothing to go back to.
+    const GameSnapshot* undo() {
+        if (snapshots.size() < 2) return nullptr;
+        snapshots.pop_back();
+        return &snapshots.back();
+    }
+
+    void clear() { snapshots.clear(); }
+    size_t size() const { return snapshots.size(); }
+
+private:
+    size_t depth;
+    std::deque<GameSnapshot> snapshots;
+};
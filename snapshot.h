@@ -0,0 +1,149 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include "hexmap.h"
+#include "entities.h"
+
+// Copy-on-write snapshots of the map and the units, for undo and autosave (savegame.h).
+// A snapshot is a list of shared, immutable blocks: the map's chunks, and the units in pages of
+// ENTITY_PAGE_UNITS. Taking a snapshot with the previous one at hand only makes new blocks for what
+// changed in between and shares the rest, so a turn's snapshot costs about what that turn touched:
+// map chunks are picked by their edit epoch (hexmap.h) without looking at a tile, unit pages are
+// compared, which is nothing next to the map.
+// Restoring is cheap as well, the map goes back on top of the snapshot's chunks and only copies a chunk
+// out when it gets written to.
+// Snapshots are never changed once taken, any thread can read (or save) one while the game goes on.
+
+struct MapSnapshot {
+    int width = 0;
+    int height = 0;
+    uint64_t mapIdentity = 0; // HexMap::identity() of the map it was taken from
+    uint32_t epoch = 0;       // that map's edit epoch that ended when it was taken
+    std::vector<std::shared_ptr<const Tile>> chunks; // MAP_CHUNK_TILES each
+};
+
+// Stats of the last snapshot taken, for the log.
+struct SnapshotStats {
+    int newChunks = 0;
+    int newPages = 0;
+};
+
+inline std::shared_ptr<const Tile> copyChunk(const Tile* tiles) {
+    std::shared_ptr<Tile> chunk(new Tile[MAP_CHUNK_TILES], std::default_delete<Tile[]>());
+    std::memcpy(chunk.get(), tiles, MAP_CHUNK_TILES * sizeof(Tile));
+    return chunk;
+}
+
+// previous is the last snapshot of the same map, if there is one. Chunks that were never written since the
+// map was made on borrowed memory (a mapped file, another snapshot) point right at that memory.
+inline MapSnapshot snapshotMap(HexMap& map, const MapSnapshot* previous = nullptr, SnapshotStats* stats = nullptr) {
+    const HexMap& tiles = map;
+    MapSnapshot s;
+    s.width = map.width();
+    s.height = map.height();
+    s.mapIdentity = map.identity();
+    s.epoch = map.nextEpoch();
+    s.chunks.resize(map.chunkCount());
+    bool incremental = previous != nullptr && previous->mapIdentity == map.identity() && previous->chunks.size() == s.chunks.size();
+    for (int c = 0; c < map.chunkCount(); c++) {
+        uint32_t edited = map.chunkEpoch(c);
+        if (incremental && edited <= previous->epoch) {
+            s.chunks[c] = previous->chunks[c];
+        } else if (edited == 0 && map.mapped()) {
+            s.chunks[c] = std::shared_ptr<const Tile>(map.backingMemory(), tiles.chunkTiles(c));
+        } else {
+            s.chunks[c] = copyChunk(tiles.chunkTiles(c));
+            if (stats != nullptr) stats->newChunks++;
+        }
+    }
+    return s;
+}
+
+// A map on top of the snapshot's chunks, nothing is copied until it's written to.
+inline HexMap restoreMap(const MapSnapshot& s) {
+    auto keep = std::make_shared<std::vector<std::shared_ptr<const Tile>>>(s.chunks);
+    std::vector<const Tile*> pointers(s.chunks.size());
+    for (size_t c = 0; c < pointers.size(); c++) pointers[c] = s.chunks[c].get();
+    return HexMap(s.width, s.height, pointers, keep);
+}
+
+// Units per snapshot page. A page is about 4KB.
+const int ENTITY_PAGE_UNITS = 256;
+
+// The components that make up the game state, the animation ones are left out (they change every frame,
+// which would make every page new every time, and a restored unit just starts its idle clip).
+struct EntityPage {
+    int32_t count;
+    int32_t tile[ENTITY_PAGE_UNITS];
+    int32_t health[ENTITY_PAGE_UNITS];
+    int32_t movePoints[ENTITY_PAGE_UNITS];
+    uint32_t idOf[ENTITY_PAGE_UNITS];
+    UnitClass unitClass[ENTITY_PAGE_UNITS];
+    Team team[ENTITY_PAGE_UNITS];
+};
+
+struct EntitySnapshot {
+    int count = 0;
+    std::vector<std::shared_ptr<const EntityPage>> pages;
+    std::shared_ptr<const EntityStore::Sparse> sparse;
+};
+
+inline EntitySnapshot snapshotUnits(const EntityStore& units, const EntitySnapshot* previous = nullptr, SnapshotStats* stats = nullptr) {
+    EntitySnapshot s;
+    s.count = units.count();
+    int pageCount = (s.count + ENTITY_PAGE_UNITS - 1) / ENTITY_PAGE_UNITS;
+    s.pages.resize(pageCount);
+    std::unique_ptr<EntityPage> page;
+    for (int p = 0; p < pageCount; p++) {
+        // filled in full (unused slots zeroed) so pages compare with memcmp
+        if (!page) page.reset(new EntityPage());
+        else std::memset(page.get(), 0, sizeof(EntityPage));
+        int first = p * ENTITY_PAGE_UNITS;
+        page->count = std::min(ENTITY_PAGE_UNITS, s.count - first);
+        for (int k = 0; k < page->count; k++) {
+            page->tile[k] = units.tile[first + k];
+            page->health[k] = units.health[first + k];
+            page->movePoints[k] = units.movePoints[first + k];
+            page->idOf[k] = units.idOf[first + k];
+            page->unitClass[k] = units.unitClass[first + k];
+            page->team[k] = units.team[first + k];
+        }
+        if (previous != nullptr && p < static_cast<int>(previous->pages.size()) &&
+            std::memcmp(previous->pages[p].get(), page.get(), sizeof(EntityPage)) == 0) {
+            s.pages[p] = previous->pages[p];
+        } else {
+            s.pages[p] = std::move(page);
+            if (stats != nullptr) stats->newPages++;
+        }
+    }
+    EntityStore::Sparse sparse = units.sparse();
+    if (previous != nullptr && previous->sparse && *previous->sparse == sparse) s.sparse = previous->sparse;
+    else s.sparse = std::make_shared<const EntityStore::Sparse>(std::move(sparse));
+    return s;
+}
+
+// Replaces every unit with the snapshot's. Animations are reset, play the idle clips afterwards.
+inline void restoreUnits(const EntitySnapshot& s, EntityStore& units, int tileCount) {
+    units.tile.resize(s.count);
+    units.health.resize(s.count);
+    units.movePoints.resize(s.count);
+    units.idOf.resize(s.count);
+    units.unitClass.resize(s.count);
+    units.team.resize(s.count);
+    units.animClip.assign(s.count, -1);
+    units.animTime.assign(s.count, 0.0f);
+    for (size_t p = 0; p < s.pages.size(); p++) {
+        const EntityPage& page = *s.pages[p];
+        int first = static_cast<int>(p) * ENTITY_PAGE_UNITS;
+        std::copy(page.tile, page.tile + page.count, units.tile.begin() + first);
+        std::copy(page.health, page.health + page.count, units.health.begin() + first);
+        std::copy(page.movePoints, page.movePoints + page.count, units.movePoints.begin() + first);
+        std::copy(page.idOf, page.idOf + page.count, units.idOf.begin() + first);
+        std::copy(page.unitClass, page.unitClass + page.count, units.unitClass.begin() + first);
+        std::copy(page.team, page.team + page.count, units.team.begin() + first);
+    }
+    units.restore(s.sparse ? *s.sparse : EntityStore::Sparse(), tileCount);
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <SDL.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "log.h"
+#include "profiler.h"
+#include "drawcalls.h"
+
+// Sprite atlas + batched drawing.
+// A TextureAtlas packs a bunch of surfaces into one texture at load time and a SpriteBatch
+// collects quads that use it, so a whole layer of sprites is one SDL_RenderGeometry call
+// instead of one SDL_RenderCopy (and texture switch) per sprite.
+
+struct AtlasRegion {
+    SDL_Rect rect;          // pixels in the atlas
+    float u0, v0, u1, v1;   // same thing normalized for SDL_Vertex::tex_coord
+};
+
+class TextureAtlas {
+public:
+    TextureAtlas() = default;
+    TextureAtlas(const TextureAtlas&) = delete;
+    TextureAtlas& operator=(const TextureAtlas&) = delete;
+    ~TextureAtlas() { destroy(); }
+
+    // Queues a surface for packing and returns its region id. The atlas takes ownership of the surface.
+    int add(const std::string& name, SDL_Surface* surface) {
+        pending.push_back(surface);
+        names.push_back(name);
+        regions.push_back(AtlasRegion{});
+        return static_cast<int>(regions.size()) - 1;
+    }
+
+    // -1 if nothing was added under that name
+    int find(const std::string& name) const {
+        for (size_t i = 0; i < names.size(); i++) {
+            if (names[i] == name) return static_cast<int>(i);
+        }
+        return -1;
+    }
+
+    // Packs everything added so far into one texture and frees the surfaces.
+    // Shelf packing (tallest first) is plenty for a few dozen sprites of similar height.
+    bool build(SDL_Renderer* renderer, int atlasWidth = 1024) {
+        const int padding = 1; // keeps linear filtering from bleeding neighbors in
+        std::vector<int> order(pending.size());
+        for (size_t i = 0; i < order.size(); i++) order[i] = static_cast<int>(i);
+        std::sort(order.begin(), order.end(), [&](int a, int b) { return pending[a]->h > pending[b]->h; });
+
+        int penX = 0;
+        int penY = 0;
+        int shelfHeight = 0;
+        for (int i : order) {
+            SDL_Surface* s = pending[i];
+            if (penX + s->w > atlasWidth) {
+                penX = 0;
+                penY += shelfHeight + padding;
+                shelfHeight = 0;
+            }
+            regions[i].rect = {penX, penY, s->w, s->h};
+            penX += s->w + padding;
+            shelfHeight = std::max(shelfHeight, s->h);
+        }
+        int atlasHeight = penY + shelfHeight;
+
+        bool ok = false;
+        SDL_Surface* sheet = SDL_CreateRGBSurfaceWithFormat(0, atlasWidth, std::max(atlasHeight, 1), 32, SDL_PIXELFORMAT_RGBA32);
+        if (sheet != nullptr) {
+            SDL_FillRect(sheet, nullptr, 0);
+            for (size_t i = 0; i < pending.size(); i++) {
+                SDL_SetSurfaceBlendMode(pending[i], SDL_BLENDMODE_NONE);
+                SDL_BlitSurface(pending[i], nullptr, sheet, &regions[i].rect);
+                const SDL_Rect& r = regions[i].rect;
+                regions[i].u0 = static_cast<float>(r.x) / sheet->w;
+                regions[i].v0 = static_cast<float>(r.y) / sheet->h;
+                regions[i].u1 = static_cast<float>(r.x + r.w) / sheet->w;
+                regions[i].v1 = static_cast<float>(r.y + r.h) / sheet->h;
+            }
+            destroy();
+            atlasTexture = SDL_CreateTextureFromSurface(renderer, sheet);
+            if (atlasTexture != nullptr) {
+                PROFILE_COUNT(PROFILE_TEXTURES_CREATED, 1);
+                SDL_SetTextureBlendMode(atlasTexture, SDL_BLENDMODE_BLEND);
+                ok = true;
+            }
+            SDL_FreeSurface(sheet);
+        }
+        for (SDL_Surface* s : pending) SDL_FreeSurface(s);
+        pending.clear();
+
+        if (!ok) LOG_ERROR("Failed to build texture atlas. SDL_Error: %s", SDL_GetError());
+        return ok;
+    }
+
+    void destroy() {
+        if (atlasTexture != nullptr) SDL_DestroyTexture(atlasTexture);
+        atlasTexture = nullptr;
+    }
+
+    SDL_Texture* texture() const { return atlasTexture; }
+    const AtlasRegion& region(int id) const { return regions[id]; }
+
+private:
+    SDL_Texture* atlasTexture = nullptr;
+    std::vector<SDL_Surface*> pending;
+    std::vector<std::string> names;
+    std::vector<AtlasRegion> regions;
+};
+
+// Quads for one texture, drawn with a single SDL_RenderGeometry call.
+// Keep batches around between frames, draw() clears them but keeps the capacity.
+class SpriteBatch {
+public:
+    void add(const AtlasRegion& src, const SDL_FRect& dest, SDL_Color color = {255, 255, 255, 255}) {
+        int base = static_cast<int>(vertices.size());
+        vertices.push_back(SDL_Vertex{{dest.x, dest.y}, color, {src.u0, src.v0}});
+        vertices.push_back(SDL_Vertex{{dest.x + dest.w, dest.y}, color, {src.u1, src.v0}});
+        vertices.push_back(SDL_Vertex{{dest.x + dest.w, dest.y + dest.h}, color, {src.u1, src.v1}});
+        vertices.push_back(SDL_Vertex{{dest.x, dest.y + dest.h}, color, {src.u0, src.v1}});
+        const int quad[6] = {0, 1, 2, 0, 2, 3};
+        for (int q : quad) indices.push_back(base + q);
+    }
+
+    // Returns the number of draw calls issued (0 for an empty batch, 1 otherwise).
+    int draw(SDL_Renderer* renderer, SDL_Texture* texture) {
+        int calls = 0;
+        if (!indices.empty()) {
+            renderGeometry(renderer, texture, vertices.data(), static_cast<int>(vertices.size()),
+                           indices.data(), static_cast<int>(indices.size()));
+            calls = 1;
+        }
+        clear();
+        return calls;
+    }
+
+    void clear() {
+        vertices.clear();
+        indices.clear();
+    }
+
+    int quads() const { return static_cast<int>(vertices.size() / 4); }
+
+private:
+    std::vector<SDL_Vertex> vertices;
+    std::vector<int> indices;
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Terrain and decoration kinds are interned into small ids when the game loads.
+// Tiles only store the id and rendering looks the sprite up by index, so there's
+// no string work per tile and a Tile stays a couple of bytes.
+// Sprites are region ids in the tile TextureAtlas (sprites.h), -1 means nothing is drawn.
+typedef uint8_t TileKindId;
+
+const TileKindId TILE_KIND_NONE = 0; // "nothing here", always registered first
+const int TILE_KIND_LIMIT = 256;      // every value a TileKindId can have
+
+struct TileKind {
+    std::string name;
+    int sprite;
+    int moveCost = 0;         // movement points to enter a tile, terrain and decoration costs add up
+    bool blocksMove = false;  // nothing can walk through it
+    bool blocksSight = false; // can't be seen through (the tile itself is still visible)
+    int cover = 0;            // cover it gives units next to it, see visibility.h
+    uint8_t tint[3] = {255, 255, 255}; // multiplied into the sprite, so kinds without their own art can share one
+};
+
+// Every possible id has an entry, the ones nobody registered look like "none" (no sprite, no cost, blocks
+// nothing), so a stray id in a map or save file can't read past the table.
+class TileRegistry {
+public:
+    TileRegistry() : kinds(TILE_KIND_LIMIT, TileKind{"none", -1}) {
+        add("none");
+    }
+
+    // Returns the existing id if the name was already registered.
+    TileKindId add(const std::string& name, int sprite = -1) {
+        auto it = ids.find(name);
+        if (it != ids.end()) {
+            if (sprite >= 0) kinds[it->second].sprite = sprite;
+            return it->second;
+        }
+        if (count == TILE_KIND_LIMIT) return TILE_KIND_NONE; // out of ids
+        TileKindId id = static_cast<TileKindId>(count++);
+        kinds[id] = TileKind{name, sprite};
+        ids.emplace(name, id);
+        return id;
+    }
+
+    // TILE_KIND_NONE for names nobody registered
+    TileKindId id(const std::string& name) const {
+        auto it = ids.find(name);
+        return it == ids.end() ? TILE_KIND_NONE : it->second;
+    }
+
+    // for filling in gameplay properties after registering
+    TileKind& kind(TileKindId id) { return kinds[id]; }
+    const TileKind& kind(TileKindId id) const { return kinds[id]; }
+
+    const std::string& name(TileKindId id) const { return kinds[id].name; }
+    int sprite(TileKindId id) const { return kinds[id].sprite; }
+    int size() const { return count; }
+
+private:
+    std::vector<TileKind> kinds; // TILE_KIND_LIMIT entries, the first count registered
+    int count = 0;
+    std::unordered_map<std::string, TileKindId> ids;
+};
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <SDL.h>
+#include <SDL_ttf.h>
+#include <array>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include "sprites.h"
+#include "log.h"
+#include "profiler.h"
+#include "drawcalls.h"
+
+// Text rendering without per-frame rasterizing.
+// GlyphAtlas holds every printable ASCII glyph of a font in one texture, so a string
+// is just a run of sub-rect copies from that texture (the renderer batches those for us).
+// TextCache keeps whole rasterized strings around for text that doesn't change often (banners etc).
+
+const int GLYPH_FIRST = 32;  // ' '
+const int GLYPH_LAST = 126;  // '~'
+const int GLYPH_COUNT = GLYPH_LAST - GLYPH_FIRST + 1;
+
+struct GlyphAtlas {
+    SDL_Texture* texture = nullptr;
+    std::array<SDL_Rect, GLYPH_COUNT> glyphs{};  // source rects into texture, indexed by c - GLYPH_FIRST
+    int lineHeight = 0;
+    int width = 0;   // texture size, for turning glyph rects into uvs
+    int height = 0;
+};
+
+// Rasterizes the glyphs in white so that callers can tint them with SDL_SetTextureColorMod.
+// Returns false if the font is missing or any SDL call fails, the atlas is left empty in that case.
+inline bool buildGlyphAtlas(SDL_Renderer* renderer, TTF_Font* font, GlyphAtlas& atlas) {
+    if (font == nullptr) return false;
+
+    const SDL_Color white = {255, 255, 255, 255};
+    const int atlasWidth = 512;
+    std::array<SDL_Surface*, GLYPH_COUNT> surfaces{};
+
+    // first pass: rasterize and lay the glyphs out in rows
+    int penX = 0;
+    int penY = 0;
+    int rowHeight = 0;
+    for (int i = 0; i < GLYPH_COUNT; i++) {
+        surfaces[i] = TTF_RenderGlyph_Blended(font, static_cast<Uint16>(GLYPH_FIRST + i), white);
+        if (surfaces[i] == nullptr) continue;
+        if (penX + surfaces[i]->w > atlasWidth) {
+            penX = 0;
+            penY += rowHeight;
+            rowHeight = 0;
+        }
+        atlas.glyphs[i] = {penX, penY, surfaces[i]->w, surfaces[i]->h};
+        penX += surfaces[i]->w;
+        if (surfaces[i]->h > rowHeight) rowHeight = surfaces[i]->h;
+    }
+
+    // second pass: blit everything into one surface and upload it once
+    bool ok = false;
+    SDL_Surface* sheet = SDL_CreateRGBSurfaceWithFormat(0, atlasWidth, penY + rowHeight, 32, SDL_PIXELFORMAT_RGBA32);
+    if (sheet != nullptr) {
+        SDL_FillRect(sheet, nullptr, 0);
+        for (int i = 0; i < GLYPH_COUNT; i++) {
+            if (surfaces[i] == nullptr) continue;
+            SDL_SetSurfaceBlendMode(surfaces[i], SDL_BLENDMODE_NONE); // copy alpha as-is
+            SDL_BlitSurface(surfaces[i], nullptr, sheet, &atlas.glyphs[i]);
+        }
+        atlas.texture = SDL_CreateTextureFromSurface(renderer, sheet);
+        if (atlas.texture != nullptr) {
+            PROFILE_COUNT(PROFILE_TEXTURES_CREATED, 1);
+            SDL_SetTextureBlendMode(atlas.texture, SDL_BLENDMODE_BLEND);
+            atlas.lineHeight = TTF_FontHeight(font);
+            atlas.width = sheet->w;
+            atlas.height = sheet->h;
+            ok = true;
+        }
+        SDL_FreeSurface(sheet);
+    }
+
+    for (SDL_Surface* s : surfaces) {
+        if (s != nullptr) SDL_FreeSurface(s);
+    }
+    if (!ok) LOG_ERROR("Failed to build glyph atlas. SDL_Error: %s", SDL_GetError());
+    return ok;
+}
+
+inline void destroyGlyphAtlas(GlyphAtlas& atlas) {
+    if (atlas.texture != nullptr) SDL_DestroyTexture(atlas.texture);
+    atlas.texture = nullptr;
+}
+
+// Width in atlas pixels of a string, characters outside the atlas count as spaces.
+inline int measureText(const GlyphAtlas& atlas, const char* text) {
+    int width = 0;
+    for (const char* c = text; *c != '\0'; c++) {
+        int i = (*c >= GLYPH_FIRST && *c <= GLYPH_LAST) ? *c - GLYPH_FIRST : 0;
+        width += atlas.glyphs[i].w;
+    }
+    return width;
+}
+
+// Draws text stretched to fill dest, the same way copying a TTF_RenderText surface into dest did.
+inline void drawText(SDL_Renderer* renderer, const GlyphAtlas& atlas, const char* text, const SDL_Rect& dest, SDL_Color color) {
+    if (atlas.texture == nullptr) return;
+    int textWidth = measureText(atlas, text);
+    if (textWidth == 0) return;
+
+    SDL_SetTextureColorMod(atlas.texture, color.r, color.g, color.b);
+    double scaleX = static_cast<double>(dest.w) / textWidth;
+    double scaleY = static_cast<double>(dest.h) / atlas.lineHeight;
+    int srcX = 0;
+    for (const char* c = text; *c != '\0'; c++) {
+        int i = (*c >= GLYPH_FIRST && *c <= GLYPH_LAST) ? *c - GLYPH_FIRST : 0;
+        const SDL_Rect& src = atlas.glyphs[i];
+        // position each glyph from its running offset so rounding doesn't accumulate
+        int x0 = dest.x + static_cast<int>(srcX * scaleX);
+        int x1 = dest.x + static_cast<int>((srcX + src.w) * scaleX);
+        SDL_Rect glyphDest = {x0, dest.y, x1 - x0, static_cast<int>(src.h * scaleY)};
+        if (*c != ' ') {
+            renderCopy(renderer, atlas.texture, &src, &glyphDest);
+        }
+        srcX += src.w;
+    }
+}
+
+// Same layout as drawText but the glyphs go into a SpriteBatch (which must be drawn with atlas.texture),
+// so all the labels on screen end up in one draw call. The color goes in the vertices, no color mod needed.
+inline void batchText(SpriteBatch& batch, const GlyphAtlas& atlas, const char* text, const SDL_Rect& dest, SDL_Color color) {
+    if (atlas.texture == nullptr) return;
+    int textWidth = measureText(atlas, text);
+    if (textWidth == 0) return;
+
+    float scaleX = static_cast<float>(dest.w) / textWidth;
+    float scaleY = static_cast<float>(dest.h) / atlas.lineHeight;
+    int srcX = 0;
+    for (const char* c = text; *c != '\0'; c++) {
+        int i = (*c >= GLYPH_FIRST && *c <= GLYPH_LAST) ? *c - GLYPH_FIRST : 0;
+        const SDL_Rect& src = atlas.glyphs[i];
+        if (*c != ' ') {
+            AtlasRegion region = {src,
+                                  static_cast<float>(src.x) / atlas.width, static_cast<float>(src.y) / atlas.height,
+                                  static_cast<float>(src.x + src.w) / atlas.width, static_cast<float>(src.y + src.h) / atlas.height};
+            SDL_FRect glyphDest = {dest.x + srcX * scaleX, static_cast<float>(dest.y), src.w * scaleX, src.h * scaleY};
+            batch.add(region, glyphDest, color);
+        }
+        srcX += src.w;
+    }
+}
+
+struct CachedText {
+    SDL_Texture* texture = nullptr;
+    int w = 0;
+    int h = 0;
+};
+
+// Whole strings rasterized once (in white) and kept as textures keyed by font + text.
+// Colors are applied at draw time with a color mod so that a recolored string doesn't need a new texture.
+class TextCache {
+public:
+    explicit TextCache(size_t maxEntries = 256) : maxEntries(maxEntries) {}
+    TextCache(const TextCache&) = delete;
+    TextCache& operator=(const TextCache&) = delete;
+    ~TextCache() { clear(); }
+
+    const CachedText& get(SDL_Renderer* renderer, TTF_Font* font, const std::string& text) {
+        std::string key = keyFor(font, text);
+        auto it = entries.find(key);
+        if (it != entries.end()) return it->second;
+
+        // dumb but predictable eviction, we only ever expect a handful of strings here
+        if (entries.size() >= maxEntries) clear();
+
+        PROFILE_ZONE("text raster");
+        CachedText entry;
+        const SDL_Color white = {255, 255, 255, 255};
+        SDL_Surface* surface = font != nullptr ? TTF_RenderText_Blended(font, text.c_str(), white) : nullptr;
+        if (surface != nullptr) {
+            entry.texture = SDL_CreateTextureFromSurface(renderer, surface);
+            if (entry.texture != nullptr) PROFILE_COUNT(PROFILE_TEXTURES_CREATED, 1);
+            entry.w = surface->w;
+            entry.h = surface->h;
+            SDL_FreeSurface(surface);
+        }
+        return entries.emplace(std::move(key), entry).first->second;
+    }
+
+    // Draws a cached string into dest with the given color, rasterizing it on first use.
+    void draw(SDL_Renderer* renderer, TTF_Font* font, const std::string& text, const SDL_Rect& dest, SDL_Color color) {
+        const CachedText& entry = get(renderer, font, text);
+        if (entry.texture == nullptr) return;
+        SDL_SetTextureColorMod(entry.texture, color.r, color.g, color.b);
+        renderCopy(renderer, entry.texture, nullptr, &dest);
+    }
+
+    void clear() {
+        for (auto& entry : entries) {
+            if (entry.second.texture != nullptr) SDL_DestroyTexture(entry.second.texture);
+        }
+        entries.clear();
+    }
+
+private:
+    static std::string keyFor(TTF_Font* font, const std::string& text) {
+        std::string key(reinterpret_cast<const char*>(&font), sizeof(font));
+        key += text;
+        return key;
+    }
+
+    std::unordered_map<std::string, CachedText> entries;
+    size_t maxEntries;
+};
@@ -0,0 +1,209 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of worker threads with one task queue each.
+//   ThreadPool pool;
+//   pool.submit([=] { decode(path); });
+//   pool.wait();
+// Tasks have to be independent of each other, wait() is the only synchronization it gives you.
+// wait() is for whoever owns the pool, it waits for every task anybody submitted. Code that shares the
+// pool, or runs on it, submits through a TaskGroup and waits for just its own tasks:
+//   TaskGroup group(pool);
+//   group.submit([=] { score(unit); });
+//   group.wait();
+//
+// Work stealing: a task submitted from one of the pool's own workers goes onto that worker's queue and
+// it takes its newest task first (cache-warm, and a task that fans out keeps its subtasks close), tasks
+// from outside are dealt out round robin. A worker whose queue is empty steals the oldest task from
+// another one, so a few slow tasks (a boss's search next to a hundred quick peasants) don't leave the
+// other cores idle. The thread calling wait() runs queued tasks too instead of just blocking, which is
+// also what makes waiting for a TaskGroup from inside a task safe.
+class ThreadPool {
+public:
+    // 0 threads = one per hardware thread, minus the one the caller is running on
+    explicit ThreadPool(int threads = 0) {
+        if (threads <= 0) threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()) - 1);
+        for (int i = 0; i < threads; i++) queues.emplace_back(new Queue());
+        for (int i = 0; i < threads; i++) workers.emplace_back([this, i] { work(i); });
+    }
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // finishes whatever is queued, then stops the workers
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& t : workers) t.join();
+    }
+
+    void submit(std::function<void()> task) { submit(std::move(task), nullptr); }
+
+    // Blocks until every task submitted so far has run, helping with them in the meantime. Not from one of
+    // the pool's tasks: that task is one of the ones it would wait for. Use a TaskGroup there.
+    void wait() {
+        assert(currentPool() != this && "ThreadPool::wait() from a pool task never returns, use a TaskGroup");
+        waitFor(pending);
+    }
+
+    // Calls body(i) for every i in [0, count), split into about four chunks per thread, and waits for them
+    // (only them, it's fine to call from a task or next to other work on the pool).
+    template <typename Body>
+    void parallelFor(int count, Body body) {
+        std::atomic<int> group{0};
+        int chunks = std::min(count, threadCount() * 4);
+        for (int c = 0; c < chunks; c++) {
+            int begin = static_cast<int>(static_cast<long long>(count) * c / chunks);
+            int end = static_cast<int>(static_cast<long long>(count) * (c + 1) / chunks);
+            submit([begin, end, &body] {
+                for (int i = begin; i < end; i++) body(i);
+            }, &group);
+        }
+        waitFor(group);
+    }
+
+    int threadCount() const { return static_cast<int>(workers.size()); }
+
+private:
+    friend class TaskGroup;
+
+    struct Task {
+        std::function<void()> body;
+        std::atomic<int>* group; // counted down when it's done, nullptr if it isn't in one
+    };
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void submit(std::function<void()> body, std::atomic<int>* group) {
+        int q = currentPool() == this ? currentWorker() : static_cast<int>(nextQueue++ % queues.size());
+        pending.fetch_add(1, std::memory_order_relaxed);
+        if (group != nullptr) group->fetch_add(1, std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock(queues[q]->mutex);
+            queues[q]->tasks.push_back(Task{std::move(body), group});
+        }
+        queued.fetch_add(1, std::memory_order_release);
+        {
+            // taken so a worker between checking queued and going to sleep can't miss the notify
+            std::lock_guard<std::mutex> lock(sleepMutex);
+        }
+        wake.notify_one();
+        idle.notify_all(); // a thread waiting for a group helps too, and might be the only one not busy
+    }
+
+    // until count gets to 0, running whatever is queued in the meantime (not just what count is counting:
+    // a task can't tell what the one it would take belongs to, and running it still gets the batch done sooner)
+    void waitFor(const std::atomic<int>& count) {
+        Task task;
+        while (count.load(std::memory_order_acquire) != 0) {
+            if (take(currentPool() == this ? currentWorker() : 0, task)) {
+                run(task);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            idle.wait(lock, [&] {
+                return count.load(std::memory_order_acquire) == 0 || queued.load(std::memory_order_acquire) > 0;
+            });
+        }
+    }
+
+    // which pool (and which of its workers) the calling thread is, nullptr for anything else
+    static ThreadPool*& currentPool() {
+        static thread_local ThreadPool* pool = nullptr;
+        return pool;
+    }
+    static int& currentWorker() {
+        static thread_local int index = 0;
+        return index;
+    }
+
+    // own queue from the back, everybody else's from the front
+    bool take(int self, Task& task) {
+        if (queued.load(std::memory_order_acquire) == 0) return false;
+        int n = static_cast<int>(queues.size());
+        for (int k = 0; k < n; k++) {
+            Queue& q = *queues[(self + k) % n];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            if (q.tasks.empty()) continue;
+            if (k == 0) {
+                task = std::move(q.tasks.back());
+                q.tasks.pop_back();
+            } else {
+                task = std::move(q.tasks.front());
+                q.tasks.pop_front();
+            }
+            queued.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+        return false;
+    }
+
+    void run(Task& task) {
+        task.body();
+        task.body = nullptr;
+        // anybody waiting for either count to get to 0 is woken up
+        bool groupDone = task.group != nullptr && task.group->fetch_sub(1, std::memory_order_acq_rel) == 1;
+        if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1 || groupDone) {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            idle.notify_all();
+        }
+    }
+
+    void work(int index) {
+        currentPool() = this;
+        currentWorker() = index;
+        Task task;
+        for (;;) {
+            if (take(index, task)) {
+                run(task);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            wake.wait(lock, [this] { return stopping || queued.load(std::memory_order_acquire) > 0; });
+            if (stopping && queued.load(std::memory_order_acquire) == 0) return;
+        }
+    }
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::atomic<int> queued{0};   // sitting in a queue
+    std::atomic<int> pending{0};  // queued + running
+    std::atomic<unsigned> nextQueue{0};
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    bool stopping = false;
+    std::vector<std::thread> workers;
+};
+
+// A batch of tasks on a pool that can be waited for without waiting for anything else on it.
+// Waits for its tasks when it goes out of scope, they usually reference things on the caller's stack.
+class TaskGroup {
+public:
+    explicit TaskGroup(ThreadPool& pool) : pool(pool) {}
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+    ~TaskGroup() { wait(); }
+
+    void submit(std::function<void()> task) { pool.submit(std::move(task), &pending); }
+
+    // blocks until this group's tasks have run, helping with the pool's work in the meantime
+    void wait() { pool.waitFor(pending); }
+
+private:
+    ThreadPool& pool;
+    std::atomic<int> pending{0};
+};
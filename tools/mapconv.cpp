@@ -0,0 +1,196 @@
+// Converts text maps into the binary map format (mapfile.h).
+//
+//   g++ -O2 -std=c++17 -pthread tools/mapconv.cpp -o mapconv
+//   ./mapconv maps/clearing.txt clearing.map
+//   ./mapconv --blank 20000 20000 plain alaska.map     (big empty map for testing streaming)
+//   ./mapconv --generate 4096 4096 1234 world.map      (procedural biomes from mapgen.h, seed 1234)
+//   ./mapconv --info clearing.map
+//
+// Text maps look like this, '#' starts a comment:
+//
+//   size 10 5                       columns and rows
+//   terrain . plain                 one character per terrain kind
+//   decoration b birch              and per decoration, '.' is always "no decoration"
+//   spawn player assault 0 0        team, class (names from entities.h) and axial q r
+//   tiles                           then one line per row, two characters per tile (terrain, decoration)
+//   .. .. .b ..
+//
+// Rows are storage rows (r + floor(q/2), see hexmap.h), so the text lines up with how the map is drawn.
+// Spaces between tiles are allowed and ignored.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../hexmap.h"
+#include "../terrain.h"
+#include "../entities.h"
+#include "../mapfile.h"
+#include "../mapgen.h"
+
+static int fail(const char* format, const char* detail, int line) {
+    fprintf(stderr, "mapconv: ");
+    fprintf(stderr, format, detail);
+    if (line > 0) fprintf(stderr, " (line %d)", line);
+    fprintf(stderr, "\n");
+    return 1;
+}
+
+static int convertText(const char* inPath, const char* outPath) {
+    std::ifstream in(inPath);
+    if (!in) return fail("can't open %s", inPath, 0);
+
+    TileRegistry terrain;
+    TileRegistry decorations;
+    TileKindId terrainOf[256] = {};
+    TileKindId decorationOf[256] = {};
+    bool terrainKnown[256] = {};
+    bool decorationKnown[256] = {};
+    decorationKnown[static_cast<unsigned char>('.')] = true;
+    std::vector<MapSpawn> spawns;
+    HexMap map;
+    int row = -1;
+
+    std::string text;
+    for (int lineNumber = 1; std::getline(in, text); lineNumber++) {
+        text = text.substr(0, text.find('#'));
+        if (row >= 0) {
+            // a row of tiles
+            std::string cells;
+            for (char c : text) {
+                if (c != ' ' && c != '\t' && c != '\r') cells += c;
+            }
+            if (cells.empty()) continue;
+            if (row >= map.height()) return fail("%s", "more tile rows than the size says", lineNumber);
+            if (static_cast<int>(cells.size()) != map.width() * 2) return fail("%s", "row doesn't have two characters per column", lineNumber);
+            for (int q = 0; q < map.width(); q++) {
+                unsigned char t = cells[q * 2];
+                unsigned char d = cells[q * 2 + 1];
+                if (!terrainKnown[t]) return fail("unknown terrain '%s'", std::string(1, t).c_str(), lineNumber);
+                if (!decorationKnown[d]) return fail("unknown decoration '%s'", std::string(1, d).c_str(), lineNumber);
+                Tile& tile = map[row * map.width() + q];
+                tile.terrain = terrainOf[t];
+                tile.decoration = decorationOf[d];
+            }
+            row++;
+            continue;
+        }
+
+        std::istringstream words(text);
+        std::string keyword;
+        if (!(words >> keyword)) continue;
+        if (keyword == "size") {
+            int w = 0, h = 0;
+            if (!(words >> w >> h) || w <= 0 || h <= 0) return fail("%s", "size needs a width and height", lineNumber);
+            map = HexMap(w, h);
+        } else if (keyword == "terrain" || keyword == "decoration") {
+            std::string symbol, name;
+            if (!(words >> symbol >> name) || symbol.size() != 1) return fail("%s needs a character and a name", keyword.c_str(), lineNumber);
+            unsigned char c = symbol[0];
+            if (keyword == "terrain") {
+                terrainOf[c] = terrain.add(name);
+                terrainKnown[c] = true;
+            } else {
+                if (c == '.') return fail("%s", "'.' is reserved for no decoration", lineNumber);
+                decorationOf[c] = decorations.add(name);
+                decorationKnown[c] = true;
+            }
+        } else if (keyword == "spawn") {
+            std::string team, cls;
+            MapSpawn spawn = {};
+            if (!(words >> team >> cls >> spawn.q >> spawn.r)) return fail("%s", "spawn needs a team, class and q r", lineNumber);
+            if (team != "player" && team != "enemy") return fail("unknown team %s", team.c_str(), lineNumber);
+            spawn.team = team == "player" ? TEAM_PLAYER : TEAM_ENEMY;
+            int found = -1;
+            for (int c = 0; c < CLASS_COUNT; c++) {
+                if (cls == CLASS_STATS[c].name) found = c;
+            }
+            if (found < 0) return fail("unknown class %s", cls.c_str(), lineNumber);
+            spawn.unitClass = static_cast<uint8_t>(found);
+            spawns.push_back(spawn);
+        } else if (keyword == "tiles") {
+            if (map.size() == 0) return fail("%s", "tiles before size", lineNumber);
+            row = 0;
+        } else {
+            return fail("unknown keyword %s", keyword.c_str(), lineNumber);
+        }
+    }
+
+    if (row != map.height()) return fail("%s", "fewer tile rows than the size says", 0);
+    for (const MapSpawn& spawn : spawns) {
+        if (!map.contains(Hex(spawn.q, spawn.r))) return fail("%s", "a spawn point is off the map", 0);
+    }
+    if (!writeMapFile(outPath, map, terrain, decorations, spawns)) return fail("can't write %s", outPath, 0);
+    printf("%s: %dx%d tiles, %d chunks, %zu spawns\n", outPath, map.width(), map.height(), map.chunkCount(), spawns.size());
+    return 0;
+}
+
+static int writeBlank(int width, int height, const char* terrainName, const char* outPath) {
+    TileRegistry terrain;
+    TileRegistry decorations;
+    TileKindId id = terrain.add(terrainName);
+    HexMap map(width, height);
+    for (auto cell : map) cell.tile.terrain = id;
+    if (!writeMapFile(outPath, map, terrain, decorations, {})) return fail("can't write %s", outPath, 0);
+    printf("%s: %dx%d tiles, %d chunks\n", outPath, width, height, map.chunkCount());
+    return 0;
+}
+
+static int writeGenerated(int width, int height, uint64_t seed, const char* outPath) {
+    TileRegistry terrain;
+    TileRegistry decorations;
+    MapGenSettings settings;
+    settings.seed = seed;
+    MapGenerator generator(registerBiomes(terrain, decorations), settings);
+    HexMap map(width, height);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<int> objectives;
+    {
+        ThreadPool workers(std::max(1, static_cast<int>(std::thread::hardware_concurrency())));
+        objectives = generator.generate(map, &workers);
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    if (!writeMapFile(outPath, map, terrain, decorations, {})) return fail("can't write %s", outPath, 0);
+    printf("%s: %dx%d tiles, %d chunks, %zu objectives, generated in %.1f ms\n", outPath, width, height, map.chunkCount(),
+           objectives.size(), ms);
+    return 0;
+}
+
+static int info(const char* path) {
+    MapFile file;
+    if (!file.open(path)) return fail("can't read %s", path, 0);
+    printf("%s: %dx%d tiles\n", path, file.width(), file.height());
+    printf("terrain:");
+    for (const std::string& name : file.terrainNames) printf(" %s", name.c_str());
+    printf("\ndecorations:");
+    for (const std::string& name : file.decorationNames) printf(" %s", name.c_str());
+    printf("\n");
+    for (const MapSpawn& spawn : file.spawns) {
+        printf("spawn %s %s %d %d\n", spawn.team == TEAM_PLAYER ? "player" : "enemy",
+               spawn.unitClass < CLASS_COUNT ? CLASS_STATS[spawn.unitClass].name : "?", spawn.q, spawn.r);
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    int result;
+    if (argc == 6 && strcmp(argv[1], "--blank") == 0) {
+        result = writeBlank(atoi(argv[2]), atoi(argv[3]), argv[4], argv[5]);
+    } else if (argc == 6 && strcmp(argv[1], "--generate") == 0) {
+        result = writeGenerated(atoi(argv[2]), atoi(argv[3]), strtoull(argv[4], nullptr, 10), argv[5]);
+    } else if (argc == 3 && strcmp(argv[1], "--info") == 0) {
+        result = info(argv[2]);
+    } else if (argc == 3) {
+        result = convertText(argv[1], argv[2]);
+    } else {
+        fprintf(stderr, "usage: mapconv in.txt out.map\n       mapconv --blank width height terrain out.map\n"
+                        "       mapconv --generate width height seed out.map\n       mapconv --info file.map\n");
+        result = 2;
+    }
+    logger().stop();
+    return result;
+}
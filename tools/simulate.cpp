@@ -0,0 +1,369 @@
+// Headless batch simulator for balancing the class system. No SDL, runs on all cores.
+//
+//   g++ -O2 -std=c++17 -pthread tools/simulate.cpp -o simulate
+//   ./simulate attacks [--count N] [--seed S] [--threads T]
+//       every class shooting at every distance in range against no/half/full cover,
+//       N attacks per cell, prints expected vs rolled hit rate and damage
+//   ./simulate skirmish [--count N] [--blue archer,heavy,...] [--red ...] [--size W H] [--seed S] [--threads T]
+//       N full battles on random maps, units walk toward the nearest enemy and shoot the easiest target,
+//       prints win rates, battle length and per class hit rate / damage / survival
+//
+// Work is split into fixed chunks that each get their own PCG stream, so the numbers only depend on the
+// seed and the count, not on how many threads ran them.
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../hexmap.h"
+#include "../terrain.h"
+#include "../entities.h"
+#include "../pathfinding.h"
+#include "../visibility.h"
+#include "../combat.h"
+#include "../rng.h"
+#include "../threadpool.h"
+
+struct Tally {
+    uint64_t attacks = 0;
+    uint64_t hits = 0;
+    uint64_t damage = 0;
+    uint64_t fielded = 0;
+    uint64_t survived = 0;
+
+    void add(const Tally& other) {
+        attacks += other.attacks;
+        hits += other.hits;
+        damage += other.damage;
+        fielded += other.fielded;
+        survived += other.survived;
+    }
+};
+
+struct Options {
+    std::string mode;
+    uint64_t count = 0;
+    uint64_t seed = 1;
+    int threads = 0;
+    int width = 24;
+    int height = 16;
+    std::vector<UnitClass> blue;
+    std::vector<UnitClass> red;
+};
+
+static bool parseTeam(const char* text, std::vector<UnitClass>& team) {
+    team.clear();
+    std::stringstream list(text);
+    std::string name;
+    while (std::getline(list, name, ',')) {
+        int found = -1;
+        for (int c = 0; c < CLASS_COUNT; c++) {
+            if (name == CLASS_STATS[c].name) found = c;
+        }
+        if (found < 0) {
+            fprintf(stderr, "simulate: unknown class %s\n", name.c_str());
+            return false;
+        }
+        team.push_back(static_cast<UnitClass>(found));
+    }
+    return !team.empty();
+}
+
+// ---- attacks: the raw hit chance table ----
+
+const int MAX_DISTANCE = 8;
+const uint64_t ATTACK_CHUNK = 1 << 16;
+
+static void runAttacks(const Options& options, ThreadPool& pool) {
+    const int cells = CLASS_COUNT * MAX_DISTANCE * 3;
+    uint64_t perCell = options.count ? options.count : 1000000;
+    uint64_t chunksPerCell = (perCell + ATTACK_CHUNK - 1) / ATTACK_CHUNK;
+    std::vector<Tally> results(cells);
+    std::vector<Tally> chunkResults(cells * chunksPerCell);
+
+    for (int cell = 0; cell < cells; cell++) {
+        int cls = cell / (MAX_DISTANCE * 3);
+        int distance = (cell / 3) % MAX_DISTANCE + 1;
+        int cover = cell % 3;
+        int chance = hitChance(static_cast<UnitClass>(cls), distance, cover);
+        if (chance == 0) continue;
+        for (uint64_t k = 0; k < chunksPerCell; k++) {
+            pool.submit([&, cls, chance, cell, k] {
+                Pcg32 rng(options.seed, cell * chunksPerCell + k);
+                uint64_t n = std::min(ATTACK_CHUNK, perCell - k * ATTACK_CHUNK);
+                Tally& tally = chunkResults[cell * chunksPerCell + k];
+                for (uint64_t i = 0; i < n; i++) {
+                    AttackResult result = rollAttack(static_cast<UnitClass>(cls), chance, rng);
+                    tally.hits += result.hit;
+                    tally.damage += result.damage;
+                }
+                tally.attacks += n;
+            });
+        }
+    }
+    pool.wait();
+    for (int cell = 0; cell < cells; cell++) {
+        for (uint64_t k = 0; k < chunksPerCell; k++) results[cell].add(chunkResults[cell * chunksPerCell + k]);
+    }
+
+    printf("%-8s %-10s %4s %-5s %7s %7s %8s %8s\n", "class", "weapon", "dist", "cover", "chance", "rolled", "dmg/att", "dmg/hit");
+    const char* coverNames[3] = {"none", "half", "full"};
+    uint64_t total = 0;
+    for (int cell = 0; cell < cells; cell++) {
+        const Tally& t = results[cell];
+        if (t.attacks == 0) continue;
+        total += t.attacks;
+        int cls = cell / (MAX_DISTANCE * 3);
+        int distance = (cell / 3) % MAX_DISTANCE + 1;
+        int cover = cell % 3;
+        printf("%-8s %-10s %4d %-5s %6d%% %6.2f%% %8.3f %8.3f\n", CLASS_STATS[cls].name, CLASS_WEAPONS[cls].name, distance,
+               coverNames[cover], hitChance(static_cast<UnitClass>(cls), distance, cover), 100.0 * t.hits / t.attacks,
+               static_cast<double>(t.damage) / t.attacks, t.hits ? static_cast<double>(t.damage) / t.hits : 0.0);
+    }
+    printf("%llu attacks\n", static_cast<unsigned long long>(total));
+}
+
+// ---- skirmish: whole battles ----
+
+const int MAX_ROUNDS = 60;
+
+struct World {
+    TileRegistry terrain;
+    TileRegistry decorations;
+    TileKindId plain;
+    TileKindId birch;
+    TileKindId tree;
+
+    World() {
+        plain = terrain.add("plain");
+        birch = decorations.add("birch");
+        tree = decorations.add("tree");
+        terrain.kind(plain).moveCost = 1;
+        decorations.kind(birch).cover = COVER_HALF;
+        decorations.kind(tree).moveCost = 1;
+        decorations.kind(tree).blocksSight = true;
+        decorations.kind(tree).cover = COVER_FULL;
+    }
+};
+
+struct BattleResult {
+    int winner = -1;  // Team, -1 for a draw
+    int rounds = 0;
+    Tally byClass[CLASS_COUNT];
+};
+
+// Scratch that's reused from battle to battle on the same thread.
+struct BattleScratch {
+    HexPathfinder pathfinder;
+    std::vector<int> reachable;
+    std::vector<EntityHandle> order;
+};
+
+static void placeTeam(const HexMap& map, EntityStore& units, Team side, const std::vector<UnitClass>& classes,
+                      Pcg32& rng, BattleResult& result) {
+    for (UnitClass cls : classes) {
+        // the two columns on the team's own edge, anywhere that's free
+        for (int attempt = 0; attempt < 1000; attempt++) {
+            int q = rng.range(0, 1);
+            if (side == TEAM_ENEMY) q = map.width() - 1 - q;
+            int row = rng.range(0, map.height() - 1);
+            int tile = row * map.width() + q;
+            if (units.occupant(tile) != NO_ENTITY) continue;
+            units.spawn(side, cls, tile);
+            result.byClass[cls].fielded++;
+            break;
+        }
+    }
+}
+
+static int teamSize(const EntityStore& units, Team side) {
+    int n = 0;
+    for (int i = 0; i < units.count(); i++) n += units.team[i] == side;
+    return n;
+}
+
+// The easiest target in sight, -1 if nobody can be hit from here.
+static int bestTarget(const HexMap& map, const EntityStore& units, int slot, const TerrainSight& sight, int& chance) {
+    int best = -1;
+    chance = 0;
+    for (int j = 0; j < units.count(); j++) {
+        if (units.team[j] == units.team[slot] || units.health[j] <= 0) continue;
+        int c = attackChance(map, units, slot, j, sight);
+        if (c > chance) {
+            chance = c;
+            best = j;
+        }
+    }
+    return best;
+}
+
+static void takeTurn(const HexMap& map, EntityStore& units, int slot, const World& world, const TerrainSight& sight,
+                     Pcg32& rng, BattleScratch& scratch, BattleResult& result) {
+    int chance = 0;
+    int target = bestTarget(map, units, slot, sight, chance);
+    if (target < 0) {
+        // walk to the reachable tile closest to any enemy
+        TerrainCost terrainCost(map, world.terrain, world.decorations);
+        auto cost = [&](int i) { return units.occupant(i) != NO_ENTITY ? PATH_BLOCKED : terrainCost(i); };
+        scratch.pathfinder.movementRange(map, units.tile[slot], units.movePoints[slot], cost, scratch.reachable);
+        int bestTile = units.tile[slot];
+        int bestDistance = INT_MAX;
+        for (int tile : scratch.reachable) {
+            Hex h = map.hexAt(tile);
+            for (int j = 0; j < units.count(); j++) {
+                if (units.team[j] == units.team[slot] || units.health[j] <= 0) continue;
+                int d = hex_distance(h, map.hexAt(units.tile[j]));
+                if (d < bestDistance) {
+                    bestDistance = d;
+                    bestTile = tile;
+                }
+            }
+        }
+        units.move(slot, bestTile);
+        target = bestTarget(map, units, slot, sight, chance);
+        if (target < 0) return;
+    }
+    AttackResult hit = attack(map, units, slot, target, sight, rng);
+    Tally& tally = result.byClass[units.unitClass[slot]];
+    tally.attacks++;
+    tally.hits += hit.hit;
+    tally.damage += hit.damage;
+}
+
+static BattleResult runBattle(const Options& options, const World& world, uint64_t battle, BattleScratch& scratch) {
+    BattleResult result;
+    Dice dice;
+    dice.seed(options.seed * 0x9E3779B97F4A7C15ULL + battle);
+
+    HexMap map(options.width, options.height);
+    for (auto cell : map) {
+        cell.tile.terrain = world.plain;
+        int roll = dice.mapgen().range(0, 99);
+        if (roll >= 90) cell.tile.decoration = world.tree;
+        else if (roll >= 80) cell.tile.decoration = world.birch;
+    }
+    EntityStore units;
+    units.resizeMap(map.size());
+    placeTeam(map, units, TEAM_PLAYER, options.blue, dice.mapgen(), result);
+    placeTeam(map, units, TEAM_ENEMY, options.red, dice.mapgen(), result);
+    TerrainSight sight(map, world.terrain, world.decorations);
+
+    for (int round = 0; round < MAX_ROUNDS; round++) {
+        result.rounds = round + 1;
+        for (Team side : {TEAM_PLAYER, TEAM_ENEMY}) {
+            units.resetMovePoints(side);
+            // by handle, slots can be reordered by deaths
+            scratch.order.clear();
+            for (int i = 0; i < units.count(); i++) {
+                if (units.team[i] == side) scratch.order.push_back(units.handle(i));
+            }
+            for (EntityHandle h : scratch.order) {
+                int slot = units.slot(h);
+                if (slot == NO_ENTITY || units.health[slot] <= 0) continue;
+                takeTurn(map, units, slot, world, sight, dice.combat(), scratch, result);
+            }
+            units.processDeaths(map);
+            int blue = teamSize(units, TEAM_PLAYER);
+            int red = teamSize(units, TEAM_ENEMY);
+            if (blue == 0 || red == 0) {
+                result.winner = blue > 0 ? TEAM_PLAYER : (red > 0 ? TEAM_ENEMY : -1);
+                for (int i = 0; i < units.count(); i++) result.byClass[units.unitClass[i]].survived++;
+                return result;
+            }
+        }
+    }
+    for (int i = 0; i < units.count(); i++) result.byClass[units.unitClass[i]].survived++;
+    return result;
+}
+
+static void runSkirmishes(const Options& options, ThreadPool& pool) {
+    uint64_t battles = options.count ? options.count : 10000;
+    const uint64_t chunk = 256;
+    uint64_t chunks = (battles + chunk - 1) / chunk;
+    World world;
+    struct ChunkResult {
+        uint64_t wins[2] = {0, 0};
+        uint64_t draws = 0;
+        uint64_t rounds = 0;
+        Tally byClass[CLASS_COUNT];
+    };
+    std::vector<ChunkResult> results(chunks);
+    for (uint64_t c = 0; c < chunks; c++) {
+        pool.submit([&, c] {
+            BattleScratch scratch;
+            ChunkResult& out = results[c];
+            for (uint64_t b = c * chunk; b < std::min(battles, (c + 1) * chunk); b++) {
+                BattleResult r = runBattle(options, world, b, scratch);
+                if (r.winner < 0) out.draws++;
+                else out.wins[r.winner]++;
+                out.rounds += r.rounds;
+                for (int k = 0; k < CLASS_COUNT; k++) out.byClass[k].add(r.byClass[k]);
+            }
+        });
+    }
+    pool.wait();
+
+    ChunkResult total;
+    for (const ChunkResult& r : results) {
+        total.wins[0] += r.wins[0];
+        total.wins[1] += r.wins[1];
+        total.draws += r.draws;
+        total.rounds += r.rounds;
+        for (int k = 0; k < CLASS_COUNT; k++) total.byClass[k].add(r.byClass[k]);
+    }
+    printf("%llu battles on %dx%d maps\n", static_cast<unsigned long long>(battles), options.width, options.height);
+    printf("blue wins %.2f%%, red wins %.2f%%, draws %.2f%%, %.2f rounds on average\n", 100.0 * total.wins[0] / battles,
+           100.0 * total.wins[1] / battles, 100.0 * total.draws / battles, static_cast<double>(total.rounds) / battles);
+    printf("%-8s %10s %8s %8s %8s %9s\n", "class", "attacks", "hit%", "dmg/att", "dmg/hit", "survived");
+    for (int k = 0; k < CLASS_COUNT; k++) {
+        const Tally& t = total.byClass[k];
+        if (t.fielded == 0) continue;
+        printf("%-8s %10llu %7.2f%% %8.3f %8.3f %8.2f%%\n", CLASS_STATS[k].name, static_cast<unsigned long long>(t.attacks),
+               t.attacks ? 100.0 * t.hits / t.attacks : 0.0, t.attacks ? static_cast<double>(t.damage) / t.attacks : 0.0,
+               t.hits ? static_cast<double>(t.damage) / t.hits : 0.0, 100.0 * t.survived / t.fielded);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    const char* defaultTeam = "archer,heavy,assault,hacker,medic";
+    parseTeam(defaultTeam, options.blue);
+    parseTeam(defaultTeam, options.red);
+    if (argc > 1) options.mode = argv[1];
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        bool more = i + 1 < argc;
+        if (arg == "--count" && more) options.count = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--seed" && more) options.seed = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--threads" && more) options.threads = std::atoi(argv[++i]);
+        else if (arg == "--size" && i + 2 < argc) {
+            options.width = std::max(4, std::atoi(argv[++i]));
+            options.height = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--blue" && more) {
+            if (!parseTeam(argv[++i], options.blue)) return 2;
+        } else if (arg == "--red" && more) {
+            if (!parseTeam(argv[++i], options.red)) return 2;
+        } else {
+            options.mode.clear();
+            break;
+        }
+    }
+    if (options.mode != "attacks" && options.mode != "skirmish") {
+        fprintf(stderr, "usage: simulate attacks|skirmish [--count N] [--seed S] [--threads T]\n"
+                        "                [--blue class,class,...] [--red class,...] [--size W H]\n");
+        return 2;
+    }
+
+    // the main thread only waits, so the pool gets every core
+    ThreadPool pool(options.threads > 0 ? options.threads : std::max(1u, std::thread::hardware_concurrency()));
+    auto start = std::chrono::steady_clock::now();
+    if (options.mode == "attacks") runAttacks(options, pool);
+    else runSkirmishes(options, pool);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%.2f s on %d threads, seed %llu\n", seconds, pool.threadCount(), static_cast<unsigned long long>(options.seed));
+    return 0;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <SDL.h>
+#include "profiler.h"
+#include "drawcalls.h"
+#include "log.h"
+
+// Screen-sized render target textures for UI that doesn't change from frame to frame.
+// A screen is split into layers by how often they change; each layer is drawn into its texture once,
+// when it's invalidated, and after that a frame is one copy per layer. Per-frame effects that only
+// recolor a layer (flashing text) go through draw()'s color mod and never dirty it.
+//
+//   if (background.begin(renderer, w, h)) { ...draw as usual...; background.end(renderer); }
+//   if (background.ready()) background.draw(renderer);
+//   else { ...draw as usual, straight to the screen... }
+//
+// A layer whose texture can't be created (no render target support, out of video memory) isn't tried
+// again every frame, only once the size changes or after destroy(), and ready() stays false meanwhile.
+// Render target contents can be lost when the device is reset, invalidate() every layer on
+// SDL_RENDER_TARGETS_RESET / SDL_RENDER_DEVICE_RESET.
+class ComposedLayer {
+public:
+    ComposedLayer() = default;
+    ComposedLayer(const ComposedLayer&) = delete;
+    ComposedLayer& operator=(const ComposedLayer&) = delete;
+    ~ComposedLayer() { destroy(); }
+
+    void invalidate() { dirty = true; }
+    bool isDirty() const { return dirty; }
+
+    // Returns true if the layer has to be redrawn, with the renderer pointed at the layer and the layer
+    // cleared to transparent. Draw it, then call end(). Returns false when the cached texture is still good,
+    // or when it can't be created (check ready()).
+    bool begin(SDL_Renderer* renderer, int width, int height) {
+        if (texture == nullptr || width != w || height != h) {
+            if (failed && width == w && height == h) return false;
+            destroy();
+            w = width;
+            h = height;
+            texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, width, height);
+            if (texture == nullptr) {
+                LOG_ERROR("Failed to create a %dx%d UI layer, drawing it directly. SDL_Error: %s", width, height, SDL_GetError());
+                failed = true;
+                return false;
+            }
+            PROFILE_COUNT(PROFILE_TEXTURES_CREATED, 1);
+            SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+        }
+        if (!dirty) return false;
+        previousTarget = SDL_GetRenderTarget(renderer);
+        SDL_SetRenderTarget(renderer, texture);
+        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+        renderClear(renderer);
+        return true;
+    }
+
+    void end(SDL_Renderer* renderer) {
+        SDL_SetRenderTarget(renderer, previousTarget);
+        dirty = false;
+    }
+
+    // false if the texture couldn't be created, whoever uses the layer draws its contents directly then
+    bool ready() const { return texture != nullptr; }
+
+    // Copies the layer over the whole screen, tinted by color (the layer itself is untouched).
+    void draw(SDL_Renderer* renderer, SDL_Color color = {255, 255, 255, 255}) const {
+        if (texture == nullptr) return;
+        SDL_SetTextureColorMod(texture, color.r, color.g, color.b);
+        renderCopy(renderer, texture, nullptr, nullptr);
+    }
+
+    // also lets begin() try again after a failure, a device reset may have fixed it
+    void destroy() {
+        if (texture != nullptr) SDL_DestroyTexture(texture);
+        texture = nullptr;
+        dirty = true;
+        failed = false;
+    }
+
+private:
+    SDL_Texture* texture = nullptr;
+    SDL_Texture* previousTarget = nullptr;
+    int w = 0;
+    int h = 0;
+    bool dirty = true;
+    bool failed = false; // couldn't create a w x h texture
+};
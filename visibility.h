@@ -0,0 +1,282 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "hex.h"
+#include "hexmap.h"
+#include "terrain.h"
+#include "entities.h"
+
+// Line of sight, field of view and cover on the HexMap.
+// - lineOfSight() walks hex_linedraw between two tiles, for single shots
+// - FieldOfView does shadow casting: rings are walked outward from the viewer and every tile that
+//   blocks sight throws an angular shadow over everything behind it, so a whole view costs one visit
+//   per tile in range no matter how many obstacles there are
+// - VisibilityCache keeps one field of view per unit and only recomputes the ones that can have changed
+// Like the pathfinder, a sight function answers per map index:
+//     bool blocksSight(int index)
+//     int cover(int index)        // CoverLevel
+// Units don't block sight, only terrain and decorations do.
+
+enum CoverLevel {
+    COVER_NONE = 0,
+    COVER_HALF = 1,
+    COVER_FULL = 2
+};
+
+// Sight and cover from the terrain + decoration registries. Just references, like TerrainCost.
+class TerrainSight {
+public:
+    TerrainSight(const HexMap& map, const TileRegistry& terrain, const TileRegistry& decorations)
+    : map(map), terrain(terrain), decorations(decorations) {}
+
+    bool blocksSight(int index) const {
+        const Tile& tile = map[index];
+        return terrain.kind(tile.terrain).blocksSight || decorations.kind(tile.decoration).blocksSight;
+    }
+
+    int cover(int index) const {
+        const Tile& tile = map[index];
+        return std::max(terrain.kind(tile.terrain).cover, decorations.kind(tile.decoration).cover);
+    }
+
+private:
+    const HexMap& map;
+    const TileRegistry& terrain;
+    const TileRegistry& decorations;
+};
+
+// True if nothing between the two tiles blocks sight. The endpoints themselves don't count,
+// you can always see the tree you're looking at.
+template <typename Sight>
+bool lineOfSight(const HexMap& map, int from, int to, const Sight& sight) {
+    if (from < 0 || to < 0) return false;
+    Hex a = map.hexAt(from);
+    Hex b = map.hexAt(to);
+    bool clear = true;
+    hex_linedraw(a, b, [&](Hex h) {
+        if (!clear || h == a || h == b) return;
+        int index = map.index(h);
+        if (index >= 0 && sight.blocksSight(index)) clear = false;
+    });
+    return clear;
+}
+
+// Cover a unit standing on target gets against a shot from attacker: the best cover among the
+// target's neighbors on the attacker's side (the ones closer to the attacker than the target is).
+// Adjacent shots get no cover. Archers ignore it, that's up to the caller (ClassStats::ignoresCover).
+template <typename Sight>
+int coverAgainst(const HexMap& map, int attacker, int target, const Sight& sight) {
+    if (attacker < 0 || target < 0) return COVER_NONE;
+    Hex from = map.hexAt(attacker);
+    int distance = hex_distance(from, map.hexAt(target));
+    if (distance <= 1) return COVER_NONE;
+    int best = COVER_NONE;
+    for (int d = 0; d < 6; d++) {
+        int next = map.neighbor(target, d);
+        if (next < 0 || hex_distance(map.hexAt(next), from) >= distance) continue;
+        best = std::max(best, sight.cover(next));
+    }
+    return best;
+}
+
+// Shadow casting field of view.
+// The angular extent of each hex around the viewer only depends on its offset, so the offsets are laid
+// out ring by ring with their angles once (per max radius) and a query is just the ring walk plus
+// interval checks against the shadows cast so far. Keep one per thread, it reuses its buffers.
+class FieldOfView {
+public:
+    // Fills visible with every tile origin can see within radius, origin included. Tiles that block sight
+    // are visible themselves but shadow what's behind them. A tile counts as visible when the middle part
+    // of it isn't completely in shadow, so peeking past the edge of an obstacle works both ways.
+    template <typename Sight>
+    void compute(const HexMap& map, int origin, int radius, const Sight& sight, std::vector<int>& visible) {
+        visible.clear();
+        if (origin < 0) return;
+        visible.push_back(origin);
+        buildOffsets(radius);
+        shadows.clear();
+
+        Hex center = map.hexAt(origin);
+        for (int k = 1; k <= radius; k++) {
+            // a ring's shadows only apply from the next ring on, tiles in the same ring don't hide each other
+            pending.clear();
+            for (int o = ringStart[k]; o < ringStart[k + 1]; o++) {
+                const ViewOffset& offset = offsets[o];
+                int index = map.index(center.q + offset.dq, center.r + offset.dr);
+                if (index < 0) continue;
+                if (!shadowed(offset.innerLo, offset.innerHi)) visible.push_back(index);
+                if (sight.blocksSight(index)) pending.push_back(Arc{offset.lo, offset.hi});
+            }
+            for (const Arc& arc : pending) addShadow(arc.start, arc.end);
+            if (fullyShadowed()) break;
+        }
+    }
+
+private:
+    struct ViewOffset {
+        int dq, dr;
+        double lo, hi;            // angles the hex covers as seen from the viewer's center
+        double innerLo, innerHi;  // middle half of that, for the visibility test
+    };
+    struct Arc {
+        double start, end;
+    };
+
+    static constexpr double TWO_PI = 6.28318530717958647692;
+
+    void buildOffsets(int radius) {
+        if (radius <= builtRadius) return;
+        // shape only, the size doesn't change any angles
+        const Layout unit(layout_flat, Point(1, 1), Point(0, 0));
+        offsets.clear();
+        ringStart.assign(radius + 2, 0);
+        for (int k = 1; k <= radius; k++) {
+            ringStart[k] = static_cast<int>(offsets.size());
+            // https://www.redblobgames.com/grids/hexagons/#rings
+            int q = HEX_DIRECTION_Q[4] * k;
+            int r = HEX_DIRECTION_R[4] * k;
+            for (int side = 0; side < 6; side++) {
+                for (int j = 0; j < k; j++) {
+                    offsets.push_back(makeOffset(unit, q, r));
+                    q += HEX_DIRECTION_Q[side];
+                    r += HEX_DIRECTION_R[side];
+                }
+            }
+        }
+        ringStart[radius + 1] = static_cast<int>(offsets.size());
+        builtRadius = radius;
+    }
+
+    static ViewOffset makeOffset(const Layout& unit, int q, int r) {
+        Point p = hex_to_pixel(unit, Hex(q, r));
+        double center = std::atan2(p.y, p.x);
+        if (center < 0) center += TWO_PI;
+        // the corners' angles relative to the center, a hex never spans more than half the circle
+        double lo = 0;
+        double hi = 0;
+        for (int c = 0; c < 6; c++) {
+            double angle = TWO_PI * (unit.orientation.start_angle + c) / 6.0;
+            double d = std::atan2(p.y + unit.size.y * std::sin(angle), p.x + unit.size.x * std::cos(angle)) - center;
+            while (d <= -TWO_PI / 2) d += TWO_PI;
+            while (d > TWO_PI / 2) d -= TWO_PI;
+            lo = std::min(lo, d);
+            hi = std::max(hi, d);
+        }
+        return ViewOffset{q, r, center + lo, center + hi, center + lo * 0.5, center + hi * 0.5};
+    }
+
+    // Spans can hang over either end of [0, 2pi), those are checked and stored in two pieces.
+    bool shadowed(double lo, double hi) const {
+        if (lo < 0) return covered(lo + TWO_PI, TWO_PI) && covered(0, hi);
+        if (hi > TWO_PI) return covered(lo, TWO_PI) && covered(0, hi - TWO_PI);
+        return covered(lo, hi);
+    }
+
+    void addShadow(double lo, double hi) {
+        if (lo < 0) {
+            insertArc(lo + TWO_PI, TWO_PI);
+            insertArc(0, hi);
+        } else if (hi > TWO_PI) {
+            insertArc(lo, TWO_PI);
+            insertArc(0, hi - TWO_PI);
+        } else {
+            insertArc(lo, hi);
+        }
+    }
+
+    // shadows are kept sorted and merged, so [a, b] is covered only if a single arc holds all of it
+    bool covered(double a, double b) const {
+        auto it = std::upper_bound(shadows.begin(), shadows.end(), a, [](double v, const Arc& arc) { return v < arc.start; });
+        if (it == shadows.begin()) return false;
+        --it;
+        return it->end >= b;
+    }
+
+    void insertArc(double a, double b) {
+        // first arc that ends at or after a, then swallow everything that starts before b
+        auto first = std::lower_bound(shadows.begin(), shadows.end(), a, [](const Arc& arc, double v) { return arc.end < v; });
+        auto last = first;
+        while (last != shadows.end() && last->start <= b) {
+            a = std::min(a, last->start);
+            b = std::max(b, last->end);
+            ++last;
+        }
+        first = shadows.erase(first, last);
+        shadows.insert(first, Arc{a, b});
+    }
+
+    bool fullyShadowed() const {
+        return shadows.size() == 1 && shadows[0].start <= 0 && shadows[0].end >= TWO_PI;
+    }
+
+    int builtRadius = 0;
+    std::vector<ViewOffset> offsets;  // ring 1 first, then ring 2, ...
+    std::vector<int> ringStart;       // ringStart[k] .. ringStart[k + 1] is ring k
+    std::vector<Arc> shadows;
+    std::vector<Arc> pending;
+};
+
+// What every unit can see, kept between turns.
+// A unit's view is recomputed when it's new or when it moved. Everyone else keeps their cached view, so
+// refreshing after one unit's move costs one field of view and not one per unit. Tiles don't change during
+// a game yet; when something can knock down a wall, the views in range of it will need dropping too.
+class VisibilityCache {
+public:
+    // Recomputes the views that may be out of date. Returns how many were recomputed.
+    template <typename Sight>
+    int refresh(const HexMap& map, const EntityStore& units, const Sight& sight) {
+        int recomputed = 0;
+        for (int s = 0; s < units.count(); s++) {
+            EntityHandle h = units.handle(s);
+            if (h.id >= views.size()) views.resize(h.id + 1);
+            UnitView& view = views[h.id];
+            int radius = CLASS_STATS[units.unitClass[s]].sightRange;
+            if (view.generation == h.generation && view.origin == units.tile[s] && view.radius == radius) continue;
+            fov.compute(map, units.tile[s], radius, sight, view.tiles);
+            std::sort(view.tiles.begin(), view.tiles.end());
+            view.generation = h.generation;
+            view.origin = units.tile[s];
+            view.radius = radius;
+            recomputed++;
+        }
+        return recomputed;
+    }
+
+    // after the map was recreated, every view is recomputed on the next refresh
+    void clear() { views.clear(); }
+
+    // Whether a unit saw the tile as of the last refresh. Handles of dead units keep answering
+    // with their last view, check EntityStore::alive first if that matters.
+    bool sees(EntityHandle h, int index) const {
+        const UnitView* view = find(h);
+        return view != nullptr && std::binary_search(view->tiles.begin(), view->tiles.end(), index);
+    }
+
+    // sorted map indices the unit saw as of the last refresh, empty if it hasn't been computed
+    const std::vector<int>& visibleTiles(EntityHandle h) const {
+        static const std::vector<int> none;
+        const UnitView* view = find(h);
+        return view != nullptr ? view->tiles : none;
+    }
+
+private:
+    struct UnitView {
+        uint32_t generation = 0;
+        int origin = -1;
+        int radius = 0;
+        std::vector<int> tiles;
+    };
+
+    const UnitView* find(EntityHandle h) const {
+        if (h.id >= views.size()) return nullptr;
+        const UnitView& view = views[h.id];
+        if (view.origin < 0 || view.generation != h.generation) return nullptr;
+        return &view;
+    }
+
+    std::vector<UnitView> views;  // indexed by EntityHandle id
+    FieldOfView fov;
+};